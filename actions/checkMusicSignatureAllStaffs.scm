@@ -3,46 +3,45 @@
 ;;; DenemoSearchMovement should be set to the movement to search in or 0 to search all movements
 ;It exits with status equal to the movement in which a match was found, or 0 if no match.
 ; Note that d-Quit only returns the status if invoked non-interactively, so this script cannot be tested interactively.
+;The staffs are read in bulk with d-GetStaffObjects, so the cursor is only moved when a match is found.
+(define (CheckMusicSignature::TopNotes staff-records)
+	;list the MIDI key of the top note of each chord in the staff, skipping rests and other objects
+	(let ((result '()))
+		(for-each
+			(lambda (measure)
+				(for-each
+					(lambda (record)
+						(let ((notes (vector-ref record 5)))
+							(if (not (null? notes))
+								(set! result (cons (vector-ref (car (last-pair notes)) 3) result)))))
+					(vector->list measure)))
+			(vector->list staff-records))
+		(reverse result)))
+
+(define (CheckMusicSignature::Matches? keys sig)
+	(cond ((null? sig) #t)
+		((or (null? keys) (null? (cdr keys))) #f)
+		((= (- (cadr keys) (car keys)) (car sig)) (CheckMusicSignature::Matches? (cdr keys) (cdr sig)))
+		(else #f)))
+
 (disp "\nChecking score " (d-GetFilename) " movements " (if (zero? DenemoSearchMovement) "All " (number->string DenemoSearchMovement)) "\n")
 (let loop ((movement_number 1))
 	(disp "Checking movement " movement_number " against " (d-GetMovementsInScore) "\n")
 	(if (<= movement_number (d-GetMovementsInScore))
-		(let loopstaff ((staff_number 1))
-		 (disp "testing at staff" staff_number " with " (zero? DenemoSearchMovement) " or " (= movement_number DenemoSearchMovement) " giving " (or (zero? DenemoSearchMovement)(= movement_number DenemoSearchMovement)) "\n\n")
+		(begin
 			(if (or (zero? DenemoSearchMovement)(= movement_number DenemoSearchMovement))
-				(begin
-					(d-GoToPosition movement_number staff_number 1 1)
-					(disp "Went to " (GetPosition) " for " DenemoSearchMovement " at " movement_number " staff " staff_number "\n\n")
-					(let ((current (d-GetNoteFromTopAsMidi))
-							(sig DenemoMusicSignature)
-							(test #f)
-							(next #f))
-						(while (and (not current) 
-							(d-NextNote))
-							(set! current (d-GetNoteFromTopAsMidi)))
-						;(disp "starting with midi note " current " at movement " movement_number " location" (GetPosition) "\n")
-						(if current
+				(let loopstaff ((staff_number 1))
+					(let ((staff-records (d-GetStaffObjects movement_number staff_number)))
+						(if staff-records
 							(begin
-								(while (and (d-NextNote) (not (null? sig)))
-									(set! next (d-GetNoteFromTopAsMidi))
-									(set! test (- next current))
-									(set! current next)
-									(if (= test (car sig))
-										(begin  
-											(set! sig (cdr sig))
-											(if (null? sig)
-												(begin
-													;(disp  "\nThe file " (d-GetFilename) " matches the given Denemo Music Signature\n")
-													(d-GoToPosition movement_number staff_number 1 1)
-													(d-Save) ;save position
-													(d-Quit (number->string movement_number)))))
-										(begin
-											(set! sig '())
-											(disp "No match at location " (GetPosition) " with pattern" DenemoMusicSignature " note discrep: " test "\n\n")
-											))))))))
-			;(disp "Reached "	movement_number " at location " (GetPosition) "\n")
-		 (if (d-StaffDown)
-				(loopstaff (1+ staff_number))
-				(loop (1+ movement_number))))))
-(disp "Exited movements loop")						
+								(if (CheckMusicSignature::Matches? (CheckMusicSignature::TopNotes staff-records) DenemoMusicSignature)
+									(begin
+										;(disp  "\nThe file " (d-GetFilename) " matches the given Denemo Music Signature\n")
+										(d-GoToPosition movement_number staff_number 1 1)
+										(d-Save) ;save position
+										(d-Quit (number->string movement_number)))
+									(disp "No match at movement " movement_number " staff " staff_number " with pattern" DenemoMusicSignature "\n\n"))
+								(loopstaff (1+ staff_number)))))))
+			(loop (1+ movement_number)))))
+(disp "Exited movements loop")
 (d-Quit "0")
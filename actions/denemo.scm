@@ -945,6 +945,14 @@
 ;Insert a no-pitch note of the prevailing duration.
 (define (d-Enter) (eval-string (string-append "(d-" (number->string (abs (d-GetPrevailingDuration))) ")" )))
 
+;Run thunk as a single batch of edits: the display, status bar and undo stage are updated once at the end
+;;the batch is ended even if thunk exits non-locally (e.g. on error). Returns the value of thunk.
+(define (d-Batch thunk)
+    (dynamic-wind
+        (lambda () (d-BeginBatch))
+        thunk
+        (lambda () (d-EndBatch))))
+
 
 ;RadioBoxMenu is a Radio-Box list where you have a pretty name and a data type.
 ;;takes any number of pairs as parameters, car is a string to show as radio-option, cdr is a return value and can be any data type, for example a function.
@@ -0,0 +1,2 @@
+;;;ExportPartsPDF
+(d-ExportPartsPDF)
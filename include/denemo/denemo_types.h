@@ -216,6 +216,7 @@ typedef enum  action_type {
   ACTION_MEASURE_CREATE,//8
   ACTION_MEASURE_INSERT,//9
   ACTION_MEASURE_DELETE,//10
+  ACTION_MEASURES_SNAPSHOT,//11
   ACTION_NOOP = -1//
 }action_type;
 
@@ -518,6 +519,9 @@ typedef struct DenemoPrefs
   gint recording_timeout;
   gboolean autoupdate;/**< update command set from denemo.org */
   gint maxhistory;/**< how long a history of used files to retain */
+  gint undo_memory_limit;/**< memory in MB each movement may use for undo information before the oldest is discarded, 0 for no limit */
+  gint typeset_cache_size;/**< disk space in MB for re-using LilyPond output of unchanged LilyPond text, 0 to disable */
+  gint max_typeset_jobs;/**< how many LilyPond processes may run at once when typesetting parts, 0 for one per processor */
   gint compression;/**< compression to be applied to .denemo files, suffix is unchanged */
   GString *browser; /**< Default browser string */
 
@@ -897,6 +901,7 @@ typedef struct DenemoRecording {
   GList *notes;  /**< data is DenemoRecordedNote* */
   gpointer sndfile; /**< sndfile handle */
   gboolean click_track_created; /**<when creating click track do not clone measures and when adding to click track, call synchronize_recording() */
+  gpointer peaks; /**< AUDIO: peaks of the audio at several resolutions, NULL until found */
 } DenemoRecording;
 
 typedef enum DenemoTargetType {
@@ -1048,6 +1053,7 @@ typedef struct DenemoMovement
   GQueue *undodata;
   GQueue *redodata;
   gint undo_guard;
+  gsize undo_memory;/*< approximate memory held by undodata, see Denemo.prefs.undo_memory_limit */
   gboolean redo_invalid;/*< the re-do queue is awaiting freeing and should not be used */
 
   GdkEventKey **divert_key_event;/*< when non-null an inner gtk_main loop is running to intercept key presses which are placed here and the main loop is quit */  
@@ -1122,6 +1128,9 @@ typedef struct DenemoProject
   DenemoSelection thumbnail; /**< the selection from which to create a thumbnail on exit */
 
   gint undo_level;/**< level of script nesting 0 = staging point for undo to return to */
+  gint undo_stage_depth;/**< number of currently open undo stages, changes within a stage can be telescoped */
+  DenemoMovement *undo_stage_movement;/**< the movement the outermost open undo stage was started on */
+  gboolean undo_trim_blocked;/**< the open undo stage alone exceeds the undo memory limit, see trim_undo_queue() */
   gboolean notsaved;/**< edited since last save */
   guint changecount;/**< number of edits since score loaded */
   guint lilysync;/**< value of changecount when the Lily text was last refreshed */
@@ -1196,6 +1205,9 @@ struct DenemoRoot
   gboolean non_interactive; /* if TRUE denemo should not display project, receive or send sounds etc*/
   gchar *scheme_file;/* filename for scheme code to run on startup */
   gchar *scheme_commands;/* scheme code to run on startup after scheme_file */
+  gchar *batch_manifest;/* file listing conversions to make instead of starting up normally */
+  gchar *batch_report;/* file for the JSON report on those conversions, NULL for standard output */
+  gint batch_jobs;/* how many conversions to make at once, 0 for one per processor */
   /* Fields used fairly directly for drawing */
   GtkWidget *page;
   GtkWidget *scorearea;
@@ -1287,6 +1299,9 @@ struct DenemoRoot
   gboolean *verbose; /** Display every messages */
   guint pending_layout_id;//Non zero when the current layout being created will be renamed to have this id 
   gint transpose_midi_in; //semitones +/- to shift MIDI in by
+  gint batch_level; /**< nesting depth of batched edits (see begin_batch_edit()), status, layout and redraw are deferred while non-zero */
+  gboolean batch_pending; /**< a status update or redraw was requested during the current batch */
+  DenemoMovement *batch_movement; /**< the movement the current batch was started on, whose undo stage it ends */
 };
 
 extern struct DenemoRoot Denemo; /**< The root object. */
@@ -26,6 +26,8 @@
 #include "sffile.h"
 #include "sf_util.h"
 #include <ctype.h>
+#include <glib.h>
+#include <glib/gstdio.h>
 
 /**
  * Convert illegal characters in soundfont
@@ -44,42 +46,214 @@ static void ConvertIllegalChar(char *name){
   }
 }
 
+/*================================================================
+ * preset index
+ *	the name, preset and bank of each preset, which is all that
+ *	Denemo needs to choose an instrument. It is read from the PHDR
+ *	chunk alone, kept for as long as the soundfont is unchanged and
+ *	saved to a cache file so that the next run need not open it.
+ *================================================================*/
+
+typedef struct _SFPresetIndex {
+	char name[21];
+	int preset, bank;
+} SFPresetIndex;
+
+#define PHDR_SIZE	38
+#define PRESET_CACHE_VERSION	1
+
+static char *preset_cache = NULL;
+
+/* set the file in which the preset index of the last soundfont parsed is kept */
+void SetSoundfontPresetCache(const char *filename)
+{
+	g_free(preset_cache);
+	preset_cache = g_strdup(filename);
+}
+
+static guint32 read_le32(const guchar *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32)p[3] << 24);
+}
+
+static guint16 read_le16(const guchar *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+/* find the chunk "id" among the chunks from p to end, returning its data and size */
+static const guchar *find_chunk(const guchar *p, const guchar *end, const char *id, const char *type, guint32 *size)
+{
+	while (end - p >= 8) {
+		guint32 len = read_le32(p + 4);
+		if (len > (guint32)(end - p - 8))
+			return NULL;
+		if (!memcmp(p, id, 4) && (type == NULL || (len >= 4 && !memcmp(p + 8, type, 4)))) {
+			*size = len;
+			return p + 8;
+		}
+		p += 8 + len + (len & 1);
+	}
+	return NULL;
+}
+
+/* read the preset index from the PHDR chunk of the mapped soundfont, returning the number of
+ * records including the terminal one, or 0 if it is not a soundfont
+ */
+static int read_preset_index(const char *soundfont, SFPresetIndex **presets)
+{
+	GMappedFile *mapped = g_mapped_file_new(soundfont, FALSE, NULL);
+	const guchar *data, *end, *pdta, *phdr;
+	guint32 size;
+	int i, number = 0;
+	if (mapped == NULL)
+		return 0;
+	data = (const guchar *)g_mapped_file_get_contents(mapped);
+	end = data + g_mapped_file_get_length(mapped);
+	if (data && (end - data >= 12) && !memcmp(data, "RIFF", 4) && !memcmp(data + 8, "sfbk", 4)
+	    && (pdta = find_chunk(data + 12, end, "LIST", "pdta", &size))
+	    && (phdr = find_chunk(pdta + 4, pdta + size, "phdr", NULL, &size))) {
+		number = size / PHDR_SIZE;
+		*presets = g_new0(SFPresetIndex, number);
+		for (i = 0; i < number; i++, phdr += PHDR_SIZE) {
+			memcpy((*presets)[i].name, phdr, 20);
+			(*presets)[i].preset = read_le16(phdr + 20);
+			(*presets)[i].bank = read_le16(phdr + 22);
+		}
+	}
+	g_mapped_file_unref(mapped);
+	return number;
+}
+
+/* read the preset index with the full parser, for soundfonts the PHDR reader does not recognize */
+static int load_preset_index(const char *soundfont, SFPresetIndex **presets)
+{
+	SFInfo sf;
+	FILE *fp;
+	int i, number;
+	if ((fp = fopen(soundfont, "rb")) == NULL) {
+		printf("\ncan't open soundfont file\n");
+		return 0;
+	}
+	memset(&sf, 0, sizeof(sf));
+	if (load_soundfont(&sf, fp, TRUE)) {
+		fclose(fp);
+		return 0;
+	}
+	fclose(fp);
+	number = sf.npresets;
+	*presets = g_new0(SFPresetIndex, number);
+	for (i = 0; i < number; i++) {
+		memcpy((*presets)[i].name, sf.preset[i].hdr.name, 20);
+		(*presets)[i].preset = sf.preset[i].preset;
+		(*presets)[i].bank = sf.preset[i].bank;
+	}
+	free_soundfont(&sf);
+	return number;
+}
+
+static char *preset_cache_key(const char *soundfont, GStatBuf *st)
+{
+	return g_strdup_printf("denemo-presets %d %s %" G_GINT64_FORMAT " %" G_GINT64_FORMAT, PRESET_CACHE_VERSION,
+			       soundfont, (gint64)st->st_mtime, (gint64)st->st_size);
+}
+
+/* read the preset index from the cache file if it was saved for this soundfont as it is now.
+ * The file is the key line followed by a line "preset bank name" for each record.
+ */
+static int read_preset_cache(const char *key, SFPresetIndex **presets)
+{
+	gchar *contents;
+	gchar **lines;
+	int i, number = 0;
+	if (preset_cache == NULL || !g_file_get_contents(preset_cache, &contents, NULL, NULL))
+		return 0;
+	lines = g_strsplit(contents, "\n", -1);
+	if (lines[0] && !strcmp(lines[0], key)) {
+		number = g_strv_length(lines) - 1;
+		if (number > 0 && *lines[number] == 0)
+			number--;	/* the final newline */
+		*presets = g_new0(SFPresetIndex, number);
+		for (i = 0; i < number; i++) {
+			char *p = lines[i + 1];
+			int skip = 0;
+			if (sscanf(p, "%d %d%n", &(*presets)[i].preset, &(*presets)[i].bank, &skip) < 2 || p[skip] != ' ') {
+				number = 0;
+				g_free(*presets);
+				*presets = NULL;
+				break;
+			}
+			g_strlcpy((*presets)[i].name, p + skip + 1, sizeof((*presets)[i].name));
+		}
+	}
+	g_strfreev(lines);
+	g_free(contents);
+	return number;
+}
+
+static void write_preset_cache(const char *key, SFPresetIndex *presets, int number)
+{
+	GString *text;
+	int i;
+	if (preset_cache == NULL)
+		return;
+	text = g_string_new(key);
+	g_string_append_c(text, '\n');
+	for (i = 0; i < number; i++)
+		g_string_append_printf(text, "%d %d %s\n", presets[i].preset, presets[i].bank, presets[i].name);
+	if (!g_file_set_contents(preset_cache, text->str, text->len, NULL))
+		g_warning("Could not write the soundfont preset cache %s", preset_cache);
+	g_string_free(text, TRUE);
+}
+
 /**
  * parse soundfont file "soundfont" and return number of presets. If "soundfont" is NULL use previously loaded soundfont
  * if name or preset are Non-null, fill in the values for the given index (counting from 0).
+ * Only the preset headers are read, and not at all if the soundfont is unchanged since it was last parsed,
+ * either in this run or, via the cache file, in an earlier one.
  */
 int  ParseSoundfont(char *soundfont, int index, char **name, int *preset, int *bank) {
-  FILE *fp;
-  static SFInfo sf;
-  static int initialized = FALSE;
-  int i;
-  int number = 0;
-  if(soundfont) {
-		if(initialized)
-			free_soundfont(&sf);
-		if ((fp = fopen(soundfont, "rb")) == NULL) {
+	static SFPresetIndex *presets = NULL;
+	static int number = 0;
+	static char *loaded = NULL;	/* key of the soundfont the presets are from */
+	if(soundfont) {
+		GStatBuf st;
+		char *key;
+		int i;
+		if (g_stat(soundfont, &st)) {
 			printf("\ncan't open soundfont file\n");
 			return 0;
-		} else if (load_soundfont(&sf, fp, TRUE)) {
-			return 0;
-		} else {
-			initialized = TRUE;
-			fclose(fp);
 		}
-		for (i = 0; i < sf.npresets-1; i++) {
-			ConvertIllegalChar(sf.preset[i].hdr.name);
+		key = preset_cache_key(soundfont, &st);
+		if (loaded == NULL || strcmp(key, loaded)) {
+			g_free(presets);
+			presets = NULL;
+			g_free(loaded);
+			loaded = NULL;
+			number = read_preset_cache(key, &presets);
+			if (number == 0) {
+				number = read_preset_index(soundfont, &presets);
+				if (number == 0)
+					number = load_preset_index(soundfont, &presets);
+				for (i = 0; i < number; i++)
+					ConvertIllegalChar(presets[i].name);
+				if (number)
+					write_preset_cache(key, presets, number);
+			}
+			if (number)
+				loaded = g_strdup(key);
 		}
+		g_free(key);
+		if (loaded == NULL)
+			return 0;
 	}
-	if(initialized) {
-		number = sf.npresets;
-		if(index<number) {
-			if(name)
-				*name = sf.preset[index].hdr.name;
-			if(preset)
-				*preset = sf.preset[index].preset;
-			if(bank)
-				*bank = sf.preset[index].bank;
-		}
+	if(index<number) {
+		if(name)
+			*name = presets[index].name;
+		if(preset)
+			*preset = presets[index].preset;
+		if(bank)
+			*bank = presets[index].bank;
 	}
 	return number;
 }
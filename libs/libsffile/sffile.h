@@ -122,6 +122,8 @@ int load_soundfont(SFInfo *sf, FILE *fp, int is_seekable);
 void free_soundfont(SFInfo *sf);
 void save_soundfont(SFInfo *sf, FILE *fin, FILE *fout);
 void load_textinfo(SFInfo *sf, FILE *fp);
+int ParseSoundfont(char *soundfont, int index, char **name, int *preset, int *bank);
+void SetSoundfontPresetCache(const char *filename);
 
 
 /* sample.c */
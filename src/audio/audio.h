@@ -8,6 +8,8 @@
 #define AUDIO_H
 
 
+#include <glib.h>
+
 #define DENEMO_SAMPLE_RATE (44100)
 #define DENEMO_SAMPLE_TYPE float        /*unsigned char */
 
@@ -16,6 +18,10 @@ typedef int (AubioCallback) (void *inputBuffer, void *outputBuffer, unsigned lon
 
 /* get approximate pitch in Hz of new note from audio input or 0 if none */
 double get_pitch (void);
+/* as get_pitch() also giving the monotonic time at which the note was played */
+double get_timed_pitch (gint64 * time);
+/* call fn with data on the main thread whenever a new note is found in audio input, NULL to stop */
+void set_pitch_notify (GSourceFunc fn, gpointer data);
 /* set the pitch as target for accurate pitch detection */
 void setTuningTarget (double pitch);
 /* measure the frequency of a peak in the spectrum close to the target frequency */
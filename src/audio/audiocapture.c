@@ -54,6 +54,7 @@
 // #define SAMPLE_RATE  (17932) // Test failure to open with this value.
 #define SAMPLE_RATE  DENEMO_SAMPLE_RATE
 #define NUM_SECONDS     (10)
+#define FRAMES_PER_BUFFER (256) /* small, as the pitch tracker only copies the audio in the callback */
 
 
 #define PA_SAMPLE_TYPE  paFloat32       /*paUInt8 */
@@ -370,13 +371,13 @@ pa_main (AubioCallback * fn)
   err = Pa_OpenStream (&stream,
 #ifndef PA_VERSION_19
                        Pa_GetDefaultInputDeviceID (), 1,        /* mono input */
-                       PA_SAMPLE_TYPE, NULL, paNoDevice, 0, PA_SAMPLE_TYPE, NULL, SAMPLE_RATE, 1024,    /* frames per buffer */
+                       PA_SAMPLE_TYPE, NULL, paNoDevice, 0, PA_SAMPLE_TYPE, NULL, SAMPLE_RATE, FRAMES_PER_BUFFER,
                        0,       /* number of buffers, if zero then use default minimum */
                        paClipOff,       /* we won't output out of range samples so don't bother clipping them */
                        recordCallback, NULL);
 #else
                        &inputParameters, NULL,  /* output parameters */
-                       SAMPLE_RATE, 1024,       /* frames per buffer */
+                       SAMPLE_RATE, FRAMES_PER_BUFFER,
                        paClipOff,       /* we won't output out of range samples so don't bother clipping them */
                        (PaStreamCallback *) recordCallback, NULL);
 #endif
@@ -474,6 +475,8 @@ determine_frequency (void)
 {
   static float *autocorr = 0;
   static float *autocorr2;
+  static unsigned long smoothed = 0;    /* extent of autocorr2 holding data smoothed from earlier, longer windows */
+  static double tail_weight = 1.0;      /* how much of that data beyond WindowSize remains */
   /* initialize if needed */
   if (autocorr == NULL)
     {
@@ -507,9 +510,23 @@ determine_frequency (void)
     {
       autocorr2[i] = (autocorr[i]) * PARTDERNIER + autocorr2[i] * (1 - PARTDERNIER);
     }
-  for (; i < 16384; i++)
+  /* only the part left by a longer window needs to decay, and only until it has gone */
+  if (smoothed <= WindowSize)
     {
-      autocorr2[i] = autocorr2[i] * (1 - PARTDERNIER);
+      smoothed = WindowSize;
+      tail_weight = 1.0;
+    }
+  else
+    {
+      for (; i < smoothed; i++)
+        autocorr2[i] = autocorr2[i] * (1 - PARTDERNIER);
+      tail_weight *= 1 - PARTDERNIER;
+      if (tail_weight < 1e-6)
+        {
+          for (i = WindowSize; i < smoothed; i++)
+            autocorr2[i] = 0.0;
+          smoothed = WindowSize;
+        }
     }
 
   float db = level2db (avg_abs);
@@ -551,14 +568,28 @@ determine_frequency (void)
 
 /**********************************************************************
 
-  from FFT.cpp  Dominic Mazzoni  September 2000
+  after FFT.cpp  Dominic Mazzoni  September 2000
+  The windows are real, so they are transformed as a complex transform of half the size,
+  and everything that depends only on the size of the window is computed once and kept.
 **********************************************************************/
 #define	M_PI		3.14159265358979323846  /* pi */
 #define false 0
 #define true 1
 #define bool int
-static int **gFFTBitTable = NULL;
-static const int MaxFastBits = 16;
+
+typedef struct RealFFT
+{
+  int size;                     /* number of real samples transformed */
+  int *bitrev;                  /* bit reversed indexes for the complex transform of size/2 */
+  float *cosine;                /* cos(2 pi k/size), k < size/2 */
+  float *sine;                  /* sin(2 pi k/size), k < size/2 */
+  float *window;                /* Hamming window of size samples */
+  float *in;                    /* work buffers */
+  float *re;
+  float *im;
+} RealFFT;
+
+static RealFFT *gFFT = NULL;
 
 static int
 IsPowerOfTwo (int x)
@@ -572,22 +603,6 @@ IsPowerOfTwo (int x)
   return true;
 }
 
-static int
-NumberOfBitsNeeded (int PowerOfTwo)
-{
-  int i;
-
-  if (PowerOfTwo < 2)
-    {
-      fprintf (stderr, "Error: FFT called with size %d\n", PowerOfTwo);
-      exit (1);
-    }
-
-  for (i = 0;; i++)
-    if (PowerOfTwo & (1 << i))
-      return i;
-}
-
 static int
 ReverseBits (int index, int NumBits)
 {
@@ -603,169 +618,126 @@ ReverseBits (int index, int NumBits)
 }
 
 static void
-InitFFT ()
+FreeFFT (RealFFT * f)
 {
-  gFFTBitTable = malloc (sizeof (int *) * MaxFastBits);
-
-  int len = 2;
-  int b;
-  for (b = 1; b <= MaxFastBits; b++)
-    {
-
-      gFFTBitTable[b - 1] = malloc (sizeof (int) * len);
-      int i;
-      for (i = 0; i < len; i++)
-        gFFTBitTable[b - 1][i] = ReverseBits (i, b);
-
-      len <<= 1;
-    }
+  free (f->bitrev);
+  free (f->cosine);
+  free (f->sine);
+  free (f->window);
+  free (f->in);
+  free (f->re);
+  free (f->im);
+  free (f);
 }
 
-static inline int
-FastReverseBits (int i, int NumBits)
+/* the transform for windows of size samples, made if the size has changed */
+static RealFFT *
+GetFFT (int size)
 {
-  if (NumBits <= MaxFastBits)
-    return gFFTBitTable[NumBits - 1][i];
-  else
-    return ReverseBits (i, NumBits);
+  int half = size / 2;
+  int bits, i;
+  if (gFFT && (gFFT->size == size))
+    return gFFT;
+  if (gFFT)
+    FreeFFT (gFFT);
+  gFFT = malloc (sizeof (RealFFT));
+  gFFT->size = size;
+  gFFT->bitrev = malloc (sizeof (int) * half);
+  gFFT->cosine = malloc (sizeof (float) * half);
+  gFFT->sine = malloc (sizeof (float) * half);
+  gFFT->window = malloc (sizeof (float) * size);
+  gFFT->in = malloc (sizeof (float) * size);
+  gFFT->re = malloc (sizeof (float) * (half + 1));
+  gFFT->im = malloc (sizeof (float) * (half + 1));
+  for (bits = 0; (1 << bits) < half; bits++)
+    ;
+  for (i = 0; i < half; i++)
+    {
+      gFFT->bitrev[i] = ReverseBits (i, bits);
+      gFFT->cosine[i] = cos (2 * M_PI * i / size);
+      gFFT->sine[i] = sin (2 * M_PI * i / size);
+    }
+  for (i = 0; i < size; i++)
+    gFFT->window[i] = 0.54 - 0.46 * cos (2 * M_PI * i / (size - 1));
+  return gFFT;
 }
 
 /*
- * Complex Fast Fourier Transform
+ * Complex Fast Fourier Transform of f->size/2 points, in place
  */
 
 static void
-FFT (int NumSamples, bool InverseTransform, float *RealIn, float *ImagIn, float *RealOut, float *ImagOut)
+ComplexFFT (RealFFT * f, float *re, float *im)
 {
-  int NumBits;                  /* Number of bits needed to store indices */
-  int i, j, k, n;
-  int BlockSize, BlockEnd;
-
-  double angle_numerator = 2.0 * M_PI;
-  float tr, ti;                 /* temp real, temp imaginary */
-
-  if (!IsPowerOfTwo (NumSamples))
-    {
-      fprintf (stderr, "%d is not a power of two\n", NumSamples);
-      exit (1);
-    }
-
-  if (!gFFTBitTable)
-    InitFFT ();
-
-  if (InverseTransform)
-    angle_numerator = -angle_numerator;
-
-  NumBits = NumberOfBitsNeeded (NumSamples);
-
-  /*
-   **   Do simultaneous data copy and bit-reversal ordering into outputs...
-   */
-
-  for (i = 0; i < NumSamples; i++)
-    {
-      j = FastReverseBits (i, NumBits);
-      RealOut[j] = RealIn[i];
-      ImagOut[j] = (ImagIn == NULL) ? 0.0 : ImagIn[i];
-    }
+  int n = f->size / 2;
+  int i, j, k, half, step;
 
-  /*
-   **   Do the FFT itself...
-   */
-
-  BlockEnd = 1;
-  for (BlockSize = 2; BlockSize <= NumSamples; BlockSize <<= 1)
+  for (i = 0; i < n; i++)
     {
-
-      double delta_angle = angle_numerator / (double) BlockSize;
-
-      float sm2 = sin (-2 * delta_angle);
-      float sm1 = sin (-delta_angle);
-      float cm2 = cos (-2 * delta_angle);
-      float cm1 = cos (-delta_angle);
-      float w = 2 * cm1;
-      float ar0, ar1, ar2, ai0, ai1, ai2;
-
-      for (i = 0; i < NumSamples; i += BlockSize)
+      j = f->bitrev[i];
+      if (j > i)
         {
-          ar2 = cm2;
-          ar1 = cm1;
-
-          ai2 = sm2;
-          ai1 = sm1;
-
-          for (j = i, n = 0; n < BlockEnd; j++, n++)
-            {
-              ar0 = w * ar1 - ar2;
-              ar2 = ar1;
-              ar1 = ar0;
-
-              ai0 = w * ai1 - ai2;
-              ai2 = ai1;
-              ai1 = ai0;
-
-              k = j + BlockEnd;
-              tr = ar0 * RealOut[k] - ai0 * ImagOut[k];
-              ti = ar0 * ImagOut[k] + ai0 * RealOut[k];
-
-              RealOut[k] = RealOut[j] - tr;
-              ImagOut[k] = ImagOut[j] - ti;
-
-              RealOut[j] += tr;
-              ImagOut[j] += ti;
-            }
+          float t = re[i];
+          re[i] = re[j];
+          re[j] = t;
+          t = im[i];
+          im[i] = im[j];
+          im[j] = t;
         }
-
-      BlockEnd = BlockSize;
     }
 
-  /*
-   **   Need to normalize if inverse transform...
-   */
-
-  if (InverseTransform)
-    {
-      float denom = (float) NumSamples;
-
-      for (i = 0; i < NumSamples; i++)
+  /* blocks of 2*half points, using every step'th twiddle */
+  for (half = 1, step = n; half < n; half <<= 1, step >>= 1)
+    for (i = 0; i < n; i += 2 * half)
+      for (j = i, k = 0; j < i + half; j++, k += step)
         {
-          RealOut[i] /= denom;
-          ImagOut[i] /= denom;
+          float wr = f->cosine[k], wi = -f->sine[k];
+          float tr = wr * re[j + half] - wi * im[j + half];
+          float ti = wr * im[j + half] + wi * re[j + half];
+          re[j + half] = re[j] - tr;
+          im[j + half] = im[j] - ti;
+          re[j] += tr;
+          im[j] += ti;
         }
-    }
 }
 
 /*
- * Windowing Functions
+ * Fast Fourier Transform of the f->size real samples x,
+ * giving bins 0 to size/2 in re and im (the rest are their complex conjugates)
  */
 
 static void
-WindowFunc (int whichFunction, int NumSamples, float *in)
+RealFFTransform (RealFFT * f, const float *x, float *re, float *im)
 {
-  int i;
+  int n = f->size / 2;
+  int k;
 
-  if (whichFunction == 1)
+  /* the even samples as real part and the odd as imaginary */
+  for (k = 0; k < n; k++)
     {
-      // Bartlett (triangular) window
-      for (i = 0; i < NumSamples / 2; i++)
-        {
-          in[i] *= (i / (float) (NumSamples / 2));
-          in[i + (NumSamples / 2)] *= (1.0 - (i / (float) (NumSamples / 2)));
-        }
+      re[k] = x[2 * k];
+      im[k] = x[2 * k + 1];
     }
 
-  if (whichFunction == 2)
-    {
-      // Hamming
-      for (i = 0; i < NumSamples; i++)
-        in[i] *= 0.54 - 0.46 * cos (2 * M_PI * i / (NumSamples - 1));
-    }
-
-  if (whichFunction == 3)
-    {
-      // Hanning
-      for (i = 0; i < NumSamples; i++)
-        in[i] *= 0.50 - 0.50 * cos (2 * M_PI * i / (NumSamples - 1));
+  ComplexFFT (f, re, im);
+
+  /* separate the transforms of the even and odd samples E, O and combine them as E + W^k O,
+   * using X[n-k] = conj(E[k] - W^k O[k]) to do bins k and n-k together */
+  re[n] = re[0] - im[0];
+  im[n] = 0.0;
+  re[0] = re[0] + im[0];
+  im[0] = 0.0;
+  for (k = 1; k <= n / 2; k++)
+    {
+      int j = n - k;
+      float er = (re[k] + re[j]) / 2, ei = (im[k] - im[j]) / 2;
+      float odr = (im[k] + im[j]) / 2, odi = (re[j] - re[k]) / 2;
+      float wr = f->cosine[k], wi = -f->sine[k];
+      float tr = wr * odr - wi * odi, ti = wr * odi + wi * odr;
+      re[k] = er + tr;
+      im[k] = ei + ti;
+      re[j] = er - tr;
+      im[j] = ti - ei;
     }
 }
 
@@ -784,54 +756,60 @@ Autocorrelation (float mData[], // In
       // Not enough data to get even one window
       return false;
     }
+  if (!IsPowerOfTwo (WindowSize))
+    {
+      fprintf (stderr, "%lu is not a power of two\n", WindowSize);
+      return false;
+    }
 
-//   float *mProcessed = NULL;
   float *mProcessed = *processed;
-
-//   mProcessed = new float[WindowSize];
+  RealFFT *f = GetFFT (WindowSize);
+  float *in = f->in;
+  float *re = f->re;
+  float *im = f->im;
+  const float *window = f->window;
 
   int i;
   for (i = 0; i < WindowSize; i++)
     mProcessed[i] = 0.0;
   int half = WindowSize / 2;
 
-  float *in = malloc (sizeof (float) * WindowSize);
-  float *out = malloc (sizeof (float) * WindowSize);
-  float *out2 = malloc (sizeof (float) * WindowSize);
-
   int start = 0;
   int windows = 0;
   while (start + WindowSize <= mDataLen)
     {
-      // Copy stuff into in
-      for (i = 0; i < WindowSize; i++)
-        in[i] = mData[start + i];
+      const float *x = mData + start;
 
       // Window the data to lose crazy artifacts
       // due to finite-length window
-      WindowFunc (2 /* Hamming */ , WindowSize, in);
+      for (i = 0; i < WindowSize; i++)
+        in[i] = x[i] * window[i];
 
       // Enhanced AC
 
       // Take FFT
-      FFT (WindowSize, false, in, NULL, out, out2);
+      RealFFTransform (f, in, re, im);
 
       // Compute power
-      for (i = 0; i < WindowSize; i++)
-        in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
+      for (i = 0; i <= half; i++)
+        in[i] = (re[i] * re[i]) + (im[i] * im[i]);
 
       // Tolonen and Karjalainen recommend taking the cube root
       // of the power, instead of the square root
 
-      for (i = 0; i < WindowSize; i++)
-        in[i] = pow (in[i], 1.0 / 3.0);
+      for (i = 0; i <= half; i++)
+        in[i] = cbrtf (in[i]);
+
+      // The power is symmetric about half
+      for (i = 1; i < half; i++)
+        in[WindowSize - i] = in[i];
 
       // Take FFT
-      FFT (WindowSize, false, in, NULL, out, out2);
+      RealFFTransform (f, in, re, im);
 
       // Take real part of result
       for (i = 0; i < half; i++)
-        mProcessed[i] += out[i];
+        mProcessed[i] += re[i];
 
       start += half;
       windows++;
@@ -848,16 +826,16 @@ Autocorrelation (float mData[], // In
     {
       if (mProcessed[i] < 0.0)
         mProcessed[i] = 0.0;
-      out[i] = mProcessed[i];
+      in[i] = mProcessed[i];
     }
 
   // Subtract a time-doubled signal (linearly interp.) from the original
   // (clipped) signal
   for (i = 0; i < half; i++)
     if ((i % 2) == 0)
-      mProcessed[i] -= out[i / 2];
+      mProcessed[i] -= in[i / 2];
     else
-      mProcessed[i] -= ((out[i / 2] + out[i / 2 + 1]) / 2);
+      mProcessed[i] -= ((in[i / 2] + in[i / 2 + 1]) / 2);
 
   // Clip at zero again
   for (i = 0; i < half; i++)
@@ -866,12 +844,6 @@ Autocorrelation (float mData[], // In
 
   /*  *mProcessedSize = half; */
 
-  free (in);
-  free (out);
-  free (out2);
-
-//   *processed = mProcessed;
-
   return true;
 }
 
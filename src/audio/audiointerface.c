@@ -336,27 +336,41 @@ redraw_playhead_callback (gpointer data)
   return FALSE;
 }
 
-static gboolean do_handle_midi_event (gchar *data) {
-  handle_midi_event (data);
-  g_free(data);
-  return FALSE;
-}
+static gint midi_input_scheduled;       //handle_midi_input() is due to run on the main thread
+static guint midi_latency_count;
+static gint64 midi_latency_last, midi_latency_total, midi_latency_max; //microseconds from the backend to handling the event
+
+/* on the main thread, handle all the MIDI input waiting in the queue */
 static gboolean
-handle_midi_event_callback (gpointer data)
+handle_midi_input (G_GNUC_UNUSED gpointer data)
 {
-
-  midi_event_t *ev = (midi_event_t *) data;
-
-  // TODO: handle backend type and port
-  gchar *evdata = g_malloc (sizeof (ev->data));
-  memcpy (evdata, ev->data, sizeof (ev->data));
-  g_main_context_invoke (NULL, (GSourceFunc)do_handle_midi_event, evdata);
-
-  g_free (ev);
-
+  midi_event_t ev;
+  // cleared before reading, so that events arriving from now on are handled by another call
+  g_atomic_int_set (&midi_input_scheduled, FALSE);
+  while (event_queue_read_input (get_event_queue (MIDI_BACKEND), &ev))
+    {
+      // TODO: handle backend type and port
+      midi_latency_last = g_get_monotonic_time () - ev.time;
+      midi_latency_total += midi_latency_last;
+      midi_latency_max = MAX (midi_latency_max, midi_latency_last);
+      midi_latency_count++;
+      handle_timed_midi_event ((gchar *) ev.data, ev.time);
+    }
   return FALSE;
 }
 
+guint
+get_midi_input_latency (gdouble * last, gdouble * mean, gdouble * max, gboolean reset)
+{
+  guint count = midi_latency_count;
+  *last = midi_latency_last / 1000.0;
+  *mean = count ? midi_latency_total / (1000.0 * count) : 0.0;
+  *max = midi_latency_max / 1000.0;
+  if (reset)
+    midi_latency_count = 0, midi_latency_total = midi_latency_max = 0;
+  return count;
+}
+
 
 static void
 reset_playback_queue (backend_type_t backend)
@@ -461,11 +475,10 @@ queue_thread_func (gpointer data)
 
       // TODO: audio capture
 
-      midi_event_t *ev;
-
-      while ((ev = event_queue_read_input (get_event_queue (MIDI_BACKEND))) != NULL)
+      // one wake up of the main thread for however many events have arrived
+      if (event_queue_input_pending (get_event_queue (MIDI_BACKEND)) && g_atomic_int_compare_and_exchange (&midi_input_scheduled, FALSE, TRUE))
         {
-          g_idle_add_full (G_PRIORITY_HIGH_IDLE, handle_midi_event_callback, (gpointer) ev, NULL);
+          g_idle_add_full (G_PRIORITY_HIGH_IDLE, handle_midi_input, NULL, NULL);
         }
 
 
@@ -799,6 +812,7 @@ input_midi_event (backend_type_t backend, int port, unsigned char *buffer)
   midi_event_t ev;
   ev.backend = backend;
   ev.port = port;
+  ev.time = g_get_monotonic_time ();
   // FIXME: size might be less than 3
   memcpy (&ev.data, buffer, 3);
 
@@ -127,6 +127,7 @@ typedef struct midi_event_t
   int port;
   int length;
   unsigned char data[3];
+  gint64 time;                  /* monotonic time at which the event arrived from the backend */
 } midi_event_t;
 
 
@@ -261,6 +262,18 @@ void set_playback_speed (double speed);
  */
 void input_midi_event (backend_type_t backend, int port, unsigned char *buffer);
 
+/**
+ * Gets the latency of MIDI input, from the backend receiving an event to Denemo handling it.
+ *
+ * @param[out] last   the latency of the last event handled, in milliseconds
+ * @param[out] mean   the mean latency, in milliseconds
+ * @param[out] max    the greatest latency, in milliseconds
+ * @param reset       start the mean and greatest latency afresh after this call
+ *
+ * @return            the number of events the mean and greatest latency are taken over
+ */
+guint get_midi_input_latency (gdouble * last, gdouble * mean, gdouble * max, gboolean reset);
+
 
 
 /**
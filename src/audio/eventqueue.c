@@ -323,22 +323,22 @@ event_queue_write_input (event_queue_t * queue, midi_event_t const *event)
 }
 
 
-midi_event_t *
-event_queue_read_input (event_queue_t * queue)
+gboolean
+event_queue_read_input (event_queue_t * queue, midi_event_t * event)
 {
-  if (!queue->input)
+  if (!event_queue_input_pending (queue))
     {
-      return NULL;
+      return FALSE;
     }
 
-  if (jack_ringbuffer_read_space (queue->input))
-    {
-      midi_event_t *ev = g_malloc (sizeof (midi_event_t));
-      jack_ringbuffer_read (queue->input, (char *) ev, sizeof (midi_event_t));
-      return ev;
-    }
-  else
-    {
-      return NULL;
-    }
+  size_t n = jack_ringbuffer_read (queue->input, (char *) event, sizeof (midi_event_t));
+
+  return n == sizeof (midi_event_t);
+}
+
+
+gboolean
+event_queue_input_pending (event_queue_t * queue)
+{
+  return queue->input && (jack_ringbuffer_read_space (queue->input) >= sizeof (midi_event_t));
 }
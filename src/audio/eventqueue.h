@@ -170,10 +170,16 @@ gboolean event_queue_write_input (event_queue_t * queue, midi_event_t const *eve
 /**
  * Reads an event from the input queue.
  *
- * @return  a pointer to a newly allocated structure containing the event data.
- *          The caller is responsible for calling g_free() on this pointer.
+ * @param[out] event  the event read
+ *
+ * @return  TRUE if an event was read, FALSE if the queue was empty
+ */
+gboolean event_queue_read_input (event_queue_t * queue, midi_event_t * event);
+
+/**
+ * Checks whether there are events waiting in the input queue.
  */
-midi_event_t *event_queue_read_input (event_queue_t * queue);
+gboolean event_queue_input_pending (event_queue_t * queue);
 
 
 #endif // EVENTQUEUE_H
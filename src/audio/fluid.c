@@ -29,13 +29,14 @@ void fluid_set_gain (gdouble gain)
 	if (synth)
 		fluid_synth_set_gain (synth, gain);
 }
-void reset_synth_channels (void)
+static void
+set_staff_programs (fluid_synth_t * thesynth, int thesfont_id)
 {
   // select bank 0 and preset 0 in the soundfont we just loaded on channel 0
-  fluid_synth_program_select (synth, 0, sfont_id, 0, 0);
+  fluid_synth_program_select (thesynth, 0, thesfont_id, 0, 0);
   gint i;
   for (i = 0; i < 16; i++)
-    fluid_synth_program_change (synth, i, 0);
+    fluid_synth_program_change (thesynth, i, 0);
   if (Denemo.project && Denemo.project->movement)
     {
     DenemoMovement *si = Denemo.project->movement;
@@ -43,9 +44,14 @@ void reset_synth_channels (void)
     for (curstaff = si->thescore; curstaff; curstaff=curstaff->next)
         {
         DenemoStaff *curstaffstruct = (DenemoStaff *) curstaff->data;//g_print ("Reset staff program chan %d to prog %d\n", curstaffstruct->midi_channel, curstaffstruct->midi_prognum);
-        fluid_synth_program_change (synth, curstaffstruct->midi_channel, curstaffstruct->midi_prognum);
+        fluid_synth_program_change (thesynth, curstaffstruct->midi_channel, curstaffstruct->midi_prognum);
         }
     }
+}
+
+void reset_synth_channels (void)
+{
+  set_staff_programs (synth, sfont_id);
     if (Denemo.prefs.pitchspellingchannel)
         fluid_synth_program_change (synth, Denemo.prefs.pitchspellingchannel, 17);
     set_tuning ();
@@ -129,8 +135,8 @@ fluidsynth_shutdown ()
 }
 
 
-void
-fluidsynth_feed_midi (unsigned char *event_data, size_t event_length)
+static void
+feed_synth (fluid_synth_t * synth, unsigned char *event_data, size_t event_length)
 {
   int channel = (event_data[0] & 0x0f);
   int type = (event_data[0] & 0xf0);
@@ -166,6 +172,12 @@ fluidsynth_feed_midi (unsigned char *event_data, size_t event_length)
     }
 }
 
+void
+fluidsynth_feed_midi (unsigned char *event_data, size_t event_length)
+{
+  feed_synth (synth, event_data, event_length);
+}
+
 
 static void
 fluid_all_notes_off_channel (gint chan)
@@ -205,6 +217,57 @@ fluidsynth_render_audio (unsigned int nframes, float *left_channel, float *right
   fluid_synth_write_float (synth, nframes, left_channel, 0, 1, right_channel, 0, 1);
 }
 
+/* Synths for rendering audio to file, separate from the one used for playback so that several can run at once on other threads */
+gpointer
+fluidsynth_new_offline (unsigned int samplerate, const gint * programs)
+{
+  fluid_settings_t *thesettings = new_fluid_settings ();
+  fluid_synth_t *thesynth = NULL;
+  int thesfont_id = -1;
+  gint i;
+  if (!thesettings)
+    return NULL;
+  fluid_settings_setnum (thesettings, "synth.sample-rate", (double) samplerate);
+  fluid_settings_setint (thesettings, "synth.reverb.active", Denemo.prefs.fluidsynth_reverb ? 1 : 0);
+  fluid_settings_setint (thesettings, "synth.chorus.active", Denemo.prefs.fluidsynth_chorus ? 1 : 0);
+  thesynth = new_fluid_synth (thesettings);
+  if (thesynth && g_file_test (Denemo.prefs.fluidsynth_soundfont->str, G_FILE_TEST_EXISTS))
+    thesfont_id = fluid_synth_sfload (thesynth, Denemo.prefs.fluidsynth_soundfont->str, FALSE);
+  if (thesfont_id == -1)
+    {
+      g_warning ("Could not create a synth for rendering with the soundfont %s", Denemo.prefs.fluidsynth_soundfont->str);
+      if (thesynth)
+        delete_fluid_synth (thesynth);
+      delete_fluid_settings (thesettings);
+      return NULL;
+    }
+  fluid_synth_set_gain (thesynth, synth ? fluid_synth_get_gain (synth) : 0.1);     //the same level as playback
+  fluid_synth_program_select (thesynth, 0, thesfont_id, 0, 0);
+  for (i = 0; i < 16; i++)
+    fluid_synth_program_change (thesynth, i, programs[i]);
+  return thesynth;
+}
+
+void
+fluidsynth_offline_feed_midi (gpointer thesynth, unsigned char *event_data, size_t event_length)
+{
+  feed_synth ((fluid_synth_t *) thesynth, event_data, event_length);
+}
+
+void
+fluidsynth_offline_render (gpointer thesynth, unsigned int nframes, float *left_channel, float *right_channel)
+{
+  fluid_synth_write_float ((fluid_synth_t *) thesynth, nframes, left_channel, 0, 1, right_channel, 0, 1);
+}
+
+void
+fluidsynth_free_offline (gpointer thesynth)
+{
+  fluid_settings_t *thesettings = fluid_synth_get_settings ((fluid_synth_t *) thesynth);
+  delete_fluid_synth ((fluid_synth_t *) thesynth);
+  delete_fluid_settings (thesettings);
+}
+
 /**
  * Select the soundfont to use for playback
  */
@@ -41,5 +41,15 @@ void fluidsynth_render_audio (unsigned int nframes, float *left_channel, float *
  */
 void choose_sound_font (GtkWidget * widget, GtkWidget * fluidsynth_soundfont);
 void reset_synth_channels (void);
+
+/**
+ * Creates a synth for rendering audio to file, independent of the one used for playback,
+ * with programs[i] selected on MIDI channel i. It does not look at the score, so it may be made on any thread.
+ * Returns NULL if it cannot be made.
+ */
+gpointer fluidsynth_new_offline (unsigned int samplerate, const gint * programs);
+void fluidsynth_offline_feed_midi (gpointer synth, unsigned char *event_data, size_t event_length);
+void fluidsynth_offline_render (gpointer synth, unsigned int nframes, float *left_channel, float *right_channel);
+void fluidsynth_free_offline (gpointer synth);
 void fluid_set_gain (gdouble gain);
 #endif // FLUID_H
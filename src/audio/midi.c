@@ -877,6 +877,25 @@ play_adjusted_midi_event (gchar * buf)
 
 #define EDITING_MASK (GDK_SHIFT_MASK)
 //these are event generated by a MIDI controller or Scheme script
+static gint64 midi_event_time = 0;     //monotonic time at which the MIDI event being handled arrived, 0 if unknown
+
+/* handle the MIDI event buf which arrived from the backend at monotonic time */
+void
+handle_timed_midi_event (gchar * buf, gint64 time)
+{
+  midi_event_time = time;
+  handle_midi_event (buf);
+  midi_event_time = 0;
+}
+
+/* the time in seconds at which the MIDI event being handled arrived from the backend,
+ * or the time now if it did not come from a backend (e.g. the virtual keyboard) */
+gdouble
+get_midi_event_time (void)
+{
+  return (midi_event_time ? midi_event_time : g_get_monotonic_time ()) / 1000000.0;
+}
+
 void
 handle_midi_event (gchar * buf)
 {
@@ -56,6 +56,8 @@ smf_event_t *get_smf_event (double until_time);
 void play_recorded_midi (void);
 
 void handle_midi_event (gchar * buf);
+void handle_timed_midi_event (gchar * buf, gint64 time);
+gdouble get_midi_event_time (void);
 
 
 gboolean intercept_midi_event (gint * midi);
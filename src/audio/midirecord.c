@@ -19,10 +19,14 @@
 #include "export/exportmidi.h"
 #include "export/guidedimportmidi.h"
 #include "command/lilydirectives.h"
+#include "source/sourceaudio.h"
 
 
 static gboolean playing_recorded_midi = FALSE;
 static gint recording_time;
+static GList *last_recorded;//the last node of the notes of last_recording, so that notes are appended without walking the list
+static DenemoRecording *last_recording;
+static gdouble appended_measure_duration;//seconds added to the end of the movement by appending a measure during a take, 0 if not yet known
 static GtkWidget *MidiRecordButton;//the button in the MIDI input panel that starts a MIDI recording.
 static void free_one_recorded_note (DenemoRecordedNote *n)
 	{
@@ -46,10 +50,12 @@ void delete_recording (void)
     {
       DenemoRecording *temp = Denemo.project->movement->recording;
       Denemo.project->movement->recording = NULL;
+      last_recorded = NULL;
       if (temp->sndfile)
         sf_close (temp->sndfile);
       g_free (temp->filename);
       g_list_free_full (temp->notes, (GDestroyNotify)free_one_recorded_note);
+      free_audio_peaks (temp->peaks);
       g_free (temp);
       Denemo.project->movement->recording = NULL;
       Denemo.project->movement->smfsync = G_MAXINT;
@@ -82,6 +88,7 @@ void delete_last_recorded_note (void)
 	GList *g = g_list_last (si->recording->notes);
 	DenemoRecordedNote *note = g->data;
 	gint start_of_deleted_note;
+	last_recorded = NULL;
 
 	if ((note->midi_event[0]&0xF0)==MIDI_NOTE_ON)
 		{
@@ -151,6 +158,45 @@ gdouble measure_duration (void)
 		return nextmeasure->earliest_time - themeasure->earliest_time ;
 	else return -1.0;
 }
+/* the duration of the last measure of the movement as last exported to MIDI, or of the first if that is not known */
+static gdouble final_measure_duration (void)
+{
+	DenemoMovement *si = Denemo.project->movement;
+	DenemoStaff *topstaff = (DenemoStaff*) si->thescore->data;
+	GList *last = g_list_last (topstaff->themeasures);
+	if (last && last->prev && (si->end_time > ((DenemoMeasure*)last->data)->earliest_time))
+		return si->end_time - ((DenemoMeasure*)last->data)->earliest_time;
+	return measure_duration ();
+}
+
+/* extend the movement by whole measures until it lasts until elapsed seconds.
+ * The MIDI is regenerated only to find out how long a measure is, once per take, the measures appended
+ * are taken to be as long as the last one, so that a long take does not stall while the MIDI is regenerated */
+static void extend_timebase (gdouble elapsed)
+{
+	DenemoMovement *si = Denemo.project->movement;
+	if (appended_measure_duration <= 0.0)
+		{
+			si->smfsync = G_MAXINT;
+			si->end_time = -1;
+			exportmidi (NULL, si);
+			appended_measure_duration = final_measure_duration ();
+		}
+	while (elapsed > si->end_time)
+		{
+			call_out_to_guile ("(d-AppendMeasureAllStaffs)(d-MoveToEnd)");
+			if (appended_measure_duration > 0.0)
+				si->end_time += appended_measure_duration;
+			else
+				{
+					si->end_time = -1;
+					exportmidi (NULL, si);//g_print ("appended - going to end %0.2f %0.2f\n", si->end_time, elapsed);
+					break;
+				}
+		}
+	si->smfsync = G_MAXINT;//the MIDI does not include the measures appended
+}
+
 //Add the passed midi event to a recording in Denemo.project->movement
 void record_midi (gchar * buf)
 {
@@ -162,7 +208,7 @@ void record_midi (gchar * buf)
 	static gchar last_0;//last midi event type
 	static gchar last_1;//last midi key
 	gboolean resumed = (si->recording && si->recording->notes && (si->recording->marked_onset==NULL));
-	gdouble new_time = get_time ();
+	gdouble new_time = get_midi_event_time ();
 	if ((last_0 == buf[0]) && (last_1 == buf[1]) && (new_time - old_time < 0.01))
 		return;//key bounce - ignore. This happens with mouse driven virtual keyboard
 	last_0 = buf[0];
@@ -191,6 +237,7 @@ void record_midi (gchar * buf)
 								start = get_recording_start_time ();// time at cursor, after sync-ing the smf
 							 }
 						current_time = new_time - start;
+						appended_measure_duration = 0.0;
 						si->smfsync = G_MAXINT;
 						//si->marked_onset = g_list_last (Denemo.project->movement->recording->notes);
 					}
@@ -199,22 +246,18 @@ void record_midi (gchar * buf)
 						page_viewport();
 
 				if ((new_time - current_time) > si->end_time)
-						{
-						si->smfsync = G_MAXINT;
-						si->end_time = -1;
-						exportmidi (NULL, si);
-						if ((new_time - current_time) > si->end_time)
-							{
-								call_out_to_guile ("(d-AppendMeasureAllStaffs)(d-MoveToEnd)");
-								si->end_time = -1;
-								exportmidi (NULL, si);//g_print ("appended - going to end %0.2f %0.2f\n", si->end_time, (new_time - current_time));
-							}
-						}
+						extend_timebase (new_time - current_time);
 				recording_time = (new_time - current_time) * si->recording->samplerate;
 				note->timing = recording_time;
 				//g_print ("Storing NOTE%s at %f leadin %f\n", ((buf[0]&0xF0)==MIDI_NOTE_ON)?"ON":"OFF", recording_time/(double)si->recording->samplerate, si->recording->leadin/(double)si->recording->samplerate);
 				notenum2enharmonic (buf[1], &(note->mid_c_offset), &(note->enshift), &(note->octave));
-				si->recording->notes = g_list_append (si->recording->notes, note);
+				if ((last_recording != si->recording) || (last_recorded == NULL) || last_recorded->next)
+					last_recorded = g_list_last (si->recording->notes);
+				if (last_recorded)
+					last_recorded = g_list_append (last_recorded, note)->next;
+				else
+					last_recorded = si->recording->notes = g_list_append (NULL, note);
+				last_recording = si->recording;
 				if (initial) si->recording->marked_onset = si->recording->notes;
 			}
 	if (resumed) 
@@ -984,7 +984,10 @@ pitchentry (DenemoProject * gui)
   temperament *t = (temperament *) PR_temperament;
   gint octave;
   gdouble note;
-  note = get_pitch ();
+  gint64 played = 0;
+  note = get_timed_pitch (&played);
+  if (played)
+    g_debug ("Audio note %.1f Hz found %.1f ms after it was played", note, (g_get_monotonic_time () - played) / 1000.0);
   note *= transposition_required;
   if ((note < highest_pitch) && (note > lowest_pitch))
     {
@@ -1147,6 +1150,7 @@ return -1;
   DenemoProject *gui = Denemo.project;
   if (PR_timer)
     g_source_remove (PR_timer);
+  set_pitch_notify (NULL, NULL);
 
   if (PR_enter)
     g_signal_handler_disconnect (Denemo.scorearea, PR_enter);
@@ -1785,11 +1789,18 @@ return;
   DenemoProject *gui = Denemo.project;
   if (PR_timer)
     g_source_remove (PR_timer);
+  PR_timer = 0;
 
-  PR_timer = g_timeout_add (PR_time, (GSourceFunc) pitchentry, Denemo.project);
-
-  if (PR_timer == 0)
-    g_error ("Timer id 0 - if valid the code needs re-writing (documentation not clear)");
+  if (gui->input_source == INPUTAUDIO)
+    {                           /* the pitch tracker tells us as soon as it finds a note, there is no need to poll */
+      set_pitch_notify ((GSourceFunc) pitchentry, Denemo.project);
+    }
+  else
+    {
+      PR_timer = g_timeout_add (PR_time, (GSourceFunc) pitchentry, Denemo.project);
+      if (PR_timer == 0)
+        g_error ("Timer id 0 - if valid the code needs re-writing (documentation not clear)");
+    }
   if (gui->input_source == INPUTAUDIO)
     {                           /* for input from microphone avoid accidental activation by insisting on pointer being in the score drawing area */
       gtk_widget_add_events (Denemo.scorearea, GDK_LEAVE_NOTIFY_MASK | GDK_ENTER_NOTIFY_MASK);
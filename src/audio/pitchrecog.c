@@ -33,6 +33,11 @@
 #include <aubio/aubio.h>
 #include <glib.h>
 #include "audio/pitchrecog.h"
+#ifdef _HAVE_JACK_
+#include <jack/ringbuffer.h>
+#else
+#include "audio/ringbuffer.h"
+#endif
 
 typedef int (*aubio_process_func_t) (smpl_t ** input, smpl_t ** output, int nframes);
 
@@ -43,12 +48,27 @@ static void send_noteon (smpl_t pitch, int velo);
 
 
 
+/* The audio captured is passed through a lock-free ring to a thread of its own, which tracks the pitch a hop at a time
+ * and queues the notes found for the main thread, so that neither the capture nor the GUI waits on the analysis. */
+#define RING_FRAMES (1 << 15)   /* audio waiting to be analysed, about 3/4 second */
 
-
-
-#define MAX_PITCHES (20)
-
-static smpl_t pitches[MAX_PITCHES];
+typedef struct PitchEvent
+{
+  double pitch;                 /* Hz */
+  gint64 time;                  /* monotonic time at which the note started */
+} PitchEvent;
+
+static jack_ringbuffer_t *ring = NULL;
+static GThread *tracker = NULL;
+static GMutex tracker_lock;
+static GCond tracker_cond;
+static gint tracker_running;
+static float *hop = NULL;       /* the audio of one hop, as read from the ring */
+static gint64 hop_time;         /* monotonic time at which the current hop started */
+static gint64 onset_time;       /* monotonic time of the last onset */
+static GAsyncQueue *events = NULL;      /* PitchEvents found, for the main thread */
+static GSourceFunc pitch_notify = NULL;
+static gpointer pitch_notify_data;
 
 static int usejack = 1;
 static int usedoubled = 1;
@@ -124,15 +144,31 @@ aubio_finish (void)
   aubio_cleanup ();
 }
 
-static volatile int count;
+/* on the main thread, tell whoever wants to know of each note found */
+static gboolean
+pitch_events_ready (G_GNUC_UNUSED gpointer data)
+{
+  gint n = events ? g_async_queue_length (events) : 0;
+  while (pitch_notify && (n-- > 0))
+    pitch_notify (pitch_notify_data);
+  return FALSE;
+}
 
+static void
+store_event (double pitch, gint64 time)
+{
+  PitchEvent *event = g_new (PitchEvent, 1);
+  event->pitch = pitch;
+  event->time = time;
+  g_async_queue_push (events, event);
+  g_idle_add (pitch_events_ready, NULL);
+}
 
 static void
 send_noteon (smpl_t pitch, int velo)
 {
   if (velo)
-    if (++count < MAX_PITCHES)
-      pitches[count] = pitch;
+    store_event (pitch, median ? onset_time : hop_time);
 }
 
 
@@ -160,40 +196,26 @@ get_note (fvec_t * note_buffer, fvec_t * note_buffer2)
 
 static int Stop;
 
-  int
-pitchrecog (float **input, float **output, int nframes)
+/* analyse the hop of audio in ibuf, on the tracker thread */
+static void
+analyse_hop (void)
 {
-  unsigned int pos = 0;         /*frames%dspblocksize */
-  unsigned int j;               /*frames */
-  if (Stop)
-    return Stop;
-  for (j = 0; j < (unsigned) nframes; j++)
-  {
-    if (usejack)
-    {
-      DENEMO_SAMPLE_TYPE *in = (DENEMO_SAMPLE_TYPE *) * input;
-      ibuf->data[pos] = *(in + j);   /* need threshold higher - say 0.5 to avoid repeated note detection when using this higher precision data */
-    }
-    /*when pos reaches overlap size it is time for fft to look for a note */
-    if (pos == overlap_size - 1)
-    {
-      /* block loop */
-      aubio_onset_do (o, ibuf, onset);
-      aubio_pitch_do (p, ibuf, pitch);
+  aubio_onset_do (o, ibuf, onset);
+  aubio_pitch_do (p, ibuf, pitch);
 
-      isonset = onset->data[0];
+  isonset = onset->data[0];
 
-      if (median)
-      {
-        note_append (note_buffer, pitch->data[0]);
-      }
+  if (median)
+    {
+      note_append (note_buffer, pitch->data[0]);
+    }
 
-      /* curlevel is negatif or 1 if silence */
-      curlevel = aubio_level_detection (ibuf, silence);
+  /* curlevel is negatif or 1 if silence */
+  curlevel = aubio_level_detection (ibuf, silence);
 
-      if (isonset)
-      {
-        if (curlevel == 1)
+  if (isonset)
+    {
+      if (curlevel == 1)
         {
           isonset = 0;
           if (median)
@@ -201,60 +223,135 @@ pitchrecog (float **input, float **output, int nframes)
           /* send note off */
           send_noteon (curnote, 0);
         }
-        else
-        {                   // not silent
+      else
+        {                       // not silent
+          onset_time = hop_time;
           if (median)
-          {
-            isready = 1;
-          }
+            {
+              isready = 1;
+            }
           else
-          {
-            /* kill old note */
-            send_noteon (curnote, 0);
-            /* get and send new one */
-            curnote = pitch->data[0];
-            send_noteon (curnote, 1);
-          }
+            {
+              /* kill old note */
+              send_noteon (curnote, 0);
+              /* get and send new one */
+              curnote = pitch->data[0];
+              send_noteon (curnote, 1);
+            }
 
 
         }
-      }
-      else
-      {                       //not onset
-        if (median)
+    }
+  else
+    {                           //not onset
+      if (median)
         {
           if (isready > 0)
             isready++;
           if (isready == median)
-          {
-            /* kill old note */
-            send_noteon (curnote, 0);
-
-            curnote = get_note (note_buffer, note_buffer2);
-            /* get and send new one */
-            if (curnote > 45)
-            {           //FIXME
-              send_noteon (curnote, 1);
+            {
+              /* kill old note */
+              send_noteon (curnote, 0);
+
+              curnote = get_note (note_buffer, note_buffer2);
+              /* get and send new one */
+              if (curnote > 45)
+                {               //FIXME
+                  send_noteon (curnote, 1);
+                }
             }
-          }
-        } // if median
+        }                       // if median
 
-      }
-      /* end of block loop */
-      pos = -1;                 /* so it will be zero next j loop */
+    }
+}
 
+/* analyse the audio a hop at a time as it arrives in the ring */
+static gpointer
+tracker_thread (G_GNUC_UNUSED gpointer data)
+{
+  size_t hop_bytes = overlap_size * sizeof (DENEMO_SAMPLE_TYPE);
+  uint_t j;
+  g_mutex_lock (&tracker_lock);
+  while (g_atomic_int_get (&tracker_running))
+    {
+      if (jack_ringbuffer_read_space (ring) < hop_bytes)
+        {
+          /* the capture wakes us, but it may not get the lock, so do not wait long */
+          g_cond_wait_until (&tracker_cond, &tracker_lock, g_get_monotonic_time () + 10 * G_TIME_SPAN_MILLISECOND);
+          continue;
+        }
+      g_mutex_unlock (&tracker_lock);
+      jack_ringbuffer_read (ring, (char *) hop, hop_bytes);
+      /* the hop was played before the audio still waiting in the ring */
+      hop_time = g_get_monotonic_time () - (gint64) (jack_ringbuffer_read_space (ring) / sizeof (DENEMO_SAMPLE_TYPE) + overlap_size) * G_USEC_PER_SEC / samplerate;
+      for (j = 0; j < overlap_size; j++)
+        ibuf->data[j] = hop[j];
+      analyse_hop ();
+      g_mutex_lock (&tracker_lock);
     }
-    pos++;
-  }
+  g_mutex_unlock (&tracker_lock);
+  return NULL;
+}
+
+static void
+start_tracker (void)
+{
+  if (events == NULL)
+    events = g_async_queue_new_full (g_free);
+  ring = jack_ringbuffer_create (RING_FRAMES * sizeof (DENEMO_SAMPLE_TYPE));
+  hop = g_new (float, overlap_size);
+  g_atomic_int_set (&tracker_running, TRUE);
+  tracker = g_thread_try_new ("Pitch tracker", tracker_thread, NULL, NULL);
+  if (tracker == NULL)
+    g_warning ("Could not start the pitch tracker");
+}
 
+/* stop the tracker, which must be done after the audio capture has been stopped */
+static void
+stop_tracker (void)
+{
+  if (tracker)
+    {
+      g_mutex_lock (&tracker_lock);
+      g_atomic_int_set (&tracker_running, FALSE);
+      g_cond_signal (&tracker_cond);
+      g_mutex_unlock (&tracker_lock);
+      g_thread_join (tracker);
+      tracker = NULL;
+    }
+  if (ring)
+    jack_ringbuffer_free (ring);
+  ring = NULL;
+  g_free (hop);
+  hop = NULL;
+}
+
+/* the audio capture callback, which just passes the audio on to the tracker thread */
+  int
+pitchrecog (float **input, float **output, int nframes)
+{
+  size_t bytes = nframes * sizeof (DENEMO_SAMPLE_TYPE);
+  if (Stop)
+    return Stop;
+  if (usejack && ring && *input)
+    {
+      /* whole buffers only, if the tracker has fallen behind the audio is dropped */
+      if (jack_ringbuffer_write_space (ring) >= bytes)
+        jack_ringbuffer_write (ring, (const char *) *input, bytes);
+      if (g_mutex_trylock (&tracker_lock))
+        {
+          g_cond_signal (&tracker_cond);
+          g_mutex_unlock (&tracker_lock);
+        }
+    }
   return Stop;
 }
 
 extern int pa_main (aubio_process_func_t process_func);
 
 
-#define START  init_aubio();return pa_main(pitchrecog);
-#define STOP   (void)pa_main(NULL);aubio_finish();
+#define START  init_aubio();start_tracker();return pa_main(pitchrecog);
+#define STOP   (void)pa_main(NULL);stop_tracker();aubio_finish();
 
 int
 set_silence (double shh)
@@ -282,7 +379,10 @@ set_onset_type (unsigned onset)
 #if 0
   if (onset >= sizeof (onset_types) / sizeof (aubio_onsetdetection_type))
     return 0;
-  STOP type_onset = onset_types[onset];
+#endif
+  STOP
+#if 0
+  type_onset = onset_types[onset];
 #endif
 START}
 
@@ -291,6 +391,7 @@ initialize_pitch_recognition (void)
 {
   Stop = 0;
   init_aubio ();
+  start_tracker ();
   return pa_main (pitchrecog);
 }
 
@@ -300,29 +401,45 @@ terminate_pitch_recognition (void)
 {
   g_print ("Terminating portaudio and aubio\n");
   (void) pa_main (NULL);
+  stop_tracker ();
   aubio_finish ();
   return 0;
 }
 
+/* get the pitch of the next note found and the monotonic time it was played, or 0.0 if there is none */
 double
-get_pitch (void)
+get_timed_pitch (gint64 * time)
 {
+  PitchEvent *event = events ? (PitchEvent *) g_async_queue_try_pop (events) : NULL;
   double ret = 0.0;
-  if (count)
+  if (event)
     {
-      //printf("count is %d\n", count);
-      ret = pitches[count];
-      count = 0;
+      ret = event->pitch;
+      if (time)
+        *time = event->time;
+      g_free (event);
     }
-
   return ret;
 }
 
+double
+get_pitch (void)
+{
+  return get_timed_pitch (NULL);
+}
+
+/* call fn with data on the main thread for each note found, or stop if fn is NULL */
+void
+set_pitch_notify (GSourceFunc fn, gpointer data)
+{
+  pitch_notify = fn;
+  pitch_notify_data = data;
+}
+
 void
 store_pitch (double pitch)
 {
-  send_noteon (pitch, 1);
-  // return count<MAX_PITCHES; no point in returning the status, look at it outside of interrupts.
+  store_event (pitch, g_get_monotonic_time ());
 }
 #endif // _HAVE_PORTAUDIO_
 #endif // DISABLE_AUBIO
@@ -62,6 +62,10 @@ void fluidsynth_render_audio (unsigned int nframes, float *left_channel, float *
 void choose_sound_font (GtkWidget * widget, GtkWidget * fluidsynth_soundfont){};
 void reset_synth_channels (void){};
 void fluid_set_gain (gdouble gain){};
+gpointer fluidsynth_new_offline (unsigned int samplerate, const gint * programs){return NULL;};
+void fluidsynth_offline_feed_midi (gpointer synth, unsigned char *event_data, size_t event_length){};
+void fluidsynth_offline_render (gpointer synth, unsigned int nframes, float *left_channel, float *right_channel){};
+void fluidsynth_free_offline (gpointer synth){};
 
 
 
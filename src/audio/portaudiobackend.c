@@ -113,7 +113,7 @@ static void record_audio(float ** buffers, unsigned long frames_per_buffer){
         }
       if (fp)
         {
-          if (recorded_frames / 44100 < Denemo.prefs.maxrecordingtime)
+          if (recorded_frames / sample_rate < Denemo.prefs.maxrecordingtime)
             {
               fwrite (buffers[0], sizeof (float), frames_per_buffer, fp);
               recorded_frames += frames_per_buffer;
@@ -248,6 +248,7 @@ actual_portaudio_initialize (DenemoPrefs * config)
     }
 #endif
   g_unlink (recorded_audio_filename ());
+  set_recorded_audio_samplerate (config->portaudio_sample_rate);
 
   g_message ("Initializing PortAudio backend");
   g_info("PortAudio version: %s", Pa_GetVersionText());
@@ -589,6 +589,7 @@ freechord (DenemoObject * thechord)
       //g_list_free(((chord *) thechord->object)->directives);
     }
 //FIXME we should free thechord->directives too if scripts fail to delete them
+  g_free (thechord->object);
   g_free (thechord);
 }
 
@@ -13,7 +13,7 @@ clef_new (enum clefs type)
 {
   DenemoObject *ret;
   clef *newclef = (clef *) g_malloc (sizeof (clef));
-  ret = (DenemoObject *) g_malloc (sizeof (DenemoObject));
+  ret = (DenemoObject *) g_malloc0 (sizeof (DenemoObject));
   ret->type = CLEF;
   newclef->type = type;
   ret->object = newclef;
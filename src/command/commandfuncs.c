@@ -2130,6 +2130,11 @@ displayhelper (DenemoProject * gui)
 {
   if(Denemo.non_interactive)
     return;
+  if (Denemo.batch_level)
+    {
+      Denemo.batch_pending = TRUE;
+      return;
+    }
 
   DenemoMovement *si = gui->movement;
   beamandstemdirhelper (si);
@@ -2141,6 +2146,66 @@ displayhelper (DenemoProject * gui)
   gtk_widget_queue_draw (Denemo.scorearea);
 }
 
+/**
+ * Start a batch of edits (typically from a script). Until the matching
+ * end_batch_edit() status, layout and redraw requests are only noted, and
+ * the whole batch forms a single undo stage.
+ * Batches may be nested, only the outermost one has any effect.
+ */
+void
+begin_batch_edit (void)
+{
+  if (Denemo.batch_level == 0)
+    {
+      Denemo.batch_movement = Denemo.project->movement;
+      stage_undo (Denemo.batch_movement, ACTION_STAGE_END);   //undo is a queue so this is the end :)
+      Denemo.batch_pending = FALSE;
+    }
+  Denemo.batch_level++;
+}
+
+/**
+ * End a batch of edits started with begin_batch_edit(). When the outermost
+ * batch ends the caches, beaming, accidentals and horizontal positions of
+ * the whole movement are recomputed once and the display is refreshed.
+ * @return FALSE if there was no batch in progress.
+ */
+gboolean
+end_batch_edit (void)
+{
+  DenemoProject *gui = Denemo.project;
+  DenemoMovement *si = gui->movement;
+  staffnode *curstaff;
+  if (Denemo.batch_level == 0)
+    {
+      g_warning ("End of batch requested with no batch in progress");
+      return FALSE;
+    }
+  if (--Denemo.batch_level)
+    return TRUE;
+  //the stage is ended on the movement it was started on, unless the batch deleted it
+  if ((Denemo.batch_movement == si) || g_list_find (gui->movements, Denemo.batch_movement))
+    stage_undo (Denemo.batch_movement, ACTION_STAGE_START);
+  else
+    stage_undo (si, ACTION_STAGE_START);
+  Denemo.batch_movement = NULL;
+  if (!Denemo.batch_pending)
+    return TRUE;
+  Denemo.batch_pending = FALSE;
+  cache_all ();
+  if (Denemo.non_interactive)
+    return TRUE;
+  for (curstaff = si->thescore; curstaff; curstaff = curstaff->next)
+    {
+      staff_beams_and_stems_dirs ((DenemoStaff *) curstaff->data);
+      staff_show_which_accidentals ((DenemoStaff *) curstaff->data);
+    }
+  find_xes_in_all_measures (si);
+  set_title_bar (gui);
+  displayhelper (gui);
+  return TRUE;
+}
+
 
 
 /**
@@ -2347,7 +2412,7 @@ void
 insertmeasureafter (DenemoAction* action, G_GNUC_UNUSED DenemoScriptParam* param)
 {
   DenemoMovement *si = Denemo.project->movement;
-  take_snapshot ();
+  take_measures_snapshot (si->currentstaffnum, si->currentstaffnum, si->currentmeasurenum + 1, si->currentmeasurenum);
   si->currentmeasure = addmeasures (si, si->currentmeasurenum++, 1, 0);
   si->cursor_x = 0;
   si->cursor_appending = TRUE;
@@ -2366,7 +2431,7 @@ void
 addmeasureafter (DenemoAction* action, G_GNUC_UNUSED DenemoScriptParam* param)
 {
   DenemoMovement *si = Denemo.project->movement;
-  take_snapshot ();
+  take_measures_snapshot (1, g_list_length (si->thescore), si->currentmeasurenum + 1, si->currentmeasurenum);
   si->currentmeasure = addmeasures (si, si->currentmeasurenum++, 1, 1);
   si->cursor_x = 0;
   si->cursor_appending = TRUE;
@@ -140,6 +140,8 @@ void insertion_point_for_type (DenemoMovement * si, DenemoObjType type);
 void caution (DenemoMovement * si);
 
 void displayhelper (DenemoProject * si);
+void begin_batch_edit (void);
+gboolean end_batch_edit (void);
 
 gboolean auto_save_document_timeout (DenemoProject * gui);
 
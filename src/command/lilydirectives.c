@@ -147,6 +147,24 @@ toggle_locked (GtkWidget * widget, gboolean * locked)
   *locked = !*locked;
 }
 
+/* return the link of DIRECTIVES holding the directive tagged TAG, or NULL.
+ * The lengths of the tags are compared first, which settles nearly every mismatch without reading the tag itself.
+ * There is deliberately no index by tag: the lists are plain GLists changed with g_list_* calls in chord.c, object.c,
+ * importxml.c, score.c and the Scheme callbacks, and tags are reassigned in place, so an index would go stale unnoticed.
+ */
+static GList *
+find_directive_link (GList * directives, const gchar * tag)
+{
+  gsize len = strlen (tag);
+  for (; directives; directives = directives->next)
+    {
+      GString *thetag = ((DenemoDirective *) directives->data)->tag;
+      if (thetag && (thetag->len == len) && !memcmp (thetag->str, tag, len))
+        break;
+    }
+  return directives;
+}
+
 /* lookup a directive tagged with TAG in a list DIRECTIVES and return it.
    if TAG is NULL or "" return the first directive
    else return NULL
@@ -154,23 +172,15 @@ toggle_locked (GtkWidget * widget, gboolean * locked)
 DenemoDirective *
 find_directive (GList * directives, gchar * tag)
 {
-  DenemoDirective *directive = NULL;
   if (tag && *tag)
     {
       GList *g;
       if (*tag == '\n')
         return NULL;
-      for (g = directives; g; g = g->next)
-        {
-          directive = (DenemoDirective *) g->data;
-          if (directive->tag && !strcmp (tag, directive->tag->str))
-                return directive;
-          directive = NULL;
-        }
+      g = find_directive_link (directives, tag);
+      return g ? (DenemoDirective *) g->data : NULL;
     }
-  else
-    directive = (DenemoDirective *) directives->data;
-  return directive;
+  return directives ? (DenemoDirective *) directives->data : NULL;
 }
 
 static DenemoDirective *
@@ -182,21 +192,17 @@ find_directive_number (GList * directives, gint num)
 static gboolean
 delete_directive (GList ** directives, gchar * tag)
 {
-  DenemoDirective *directive = NULL;
   if (tag)
     {
-      GList *g;
-      for (g = *directives; g; g = g->next)
+      GList *g = find_directive_link (*directives, tag);
+      if (g)
         {
-          directive = (DenemoDirective *) g->data;
-          if (directive->tag && !strcmp (tag, directive->tag->str))
-            {
-              *directives = g_list_remove (*directives, directive);
-              free_directive (directive);
-              score_status (Denemo.project, TRUE);
-              displayhelper (Denemo.project);
-              return TRUE;
-            }
+          DenemoDirective *directive = (DenemoDirective *) g->data;
+          *directives = g_list_delete_link (*directives, g);
+          free_directive (directive);
+          score_status (Denemo.project, TRUE);
+          displayhelper (Denemo.project);
+          return TRUE;
         }
     }
   return FALSE;
@@ -4047,15 +4053,12 @@ const gchar *strict_note_directive_get_tag (gchar *tag)
       note *current = get_strict_note();
       if(current==NULL) return NULL;
       GList *g = current->directives;
-      for(;g; g=g->next)
-          {
-            DenemoDirective *directive = (DenemoDirective *)g->data;
-            if(tag == NULL)
-                return directive->tag?directive->tag->str:NULL;
-            if (directive->tag && !strcmp (directive->tag->str, tag))
-                return tag;
-          }
-      return NULL;
+      if (tag == NULL)
+        {
+          DenemoDirective *directive = g ? (DenemoDirective *) g->data : NULL;
+          return (directive && directive->tag) ? directive->tag->str : NULL;
+        }
+      return find_directive_link (g, tag) ? tag : NULL;
     }
 
 
@@ -667,6 +667,7 @@ init_score (DenemoMovement * si, DenemoProject * gui)
   si->undodata = g_queue_new ();
   si->redodata = g_queue_new ();
   si->undo_guard = 1;           //do not collect undo information until file is loaded
+  si->undo_memory = 0;
 
   if(!Denemo.non_interactive){
     si->buttonbox = gtk_hbox_new (FALSE, 1);
@@ -748,6 +749,7 @@ static void clone_staff (DenemoStaff *srcStaff, DenemoStaff *thestaff)
     thestaff->staffmenu = thestaff->voicemenu = NULL;
     thestaff->sources = NULL;
     thestaff->denemo_name = g_string_new (srcStaff->denemo_name->str);
+    thestaff->subpart = srcStaff->subpart ? g_string_new (srcStaff->subpart->str) : NULL;
     thestaff->lily_name = g_string_new (srcStaff->lily_name->str);
     thestaff->midi_instrument = g_string_new (srcStaff->midi_instrument->str);
     thestaff->device_port= g_string_new (srcStaff->device_port->str);
@@ -784,10 +786,6 @@ static void clone_staff (DenemoStaff *srcStaff, DenemoStaff *thestaff)
     thestaff->leftmost_keysig = &thestaff->keysig;
     }
 
-
-    thestaff->denemo_name = g_string_new (srcStaff->denemo_name->str);
-    thestaff->lily_name = g_string_new (srcStaff->lily_name->str);
-
     thestaff->staff_directives = clone_directives (srcStaff->staff_directives);
     {
     GList *direc;
@@ -896,6 +894,58 @@ clone_movement (DenemoMovement * si)
   return newscore;
 }
 
+/* free directives belonging to a movement that is not on display: any widgets have already been destroyed or belong to the live movement */
+static void
+free_detached_directives (GList * directives)
+{
+  GList *g;
+  for (g = directives; g; g = g->next)
+    ((DenemoDirective *) g->data)->widget = NULL;
+  free_directives (directives);
+}
+
+/**
+ * frees a movement created by clone_movement(), such as an undo snapshot.
+ * The undo/redo queues, midi data and widgets are shared with (or belong to) the live movement and are not freed.
+ */
+void
+free_cloned_movement (DenemoMovement * si)
+{
+  GList *g, *h;
+  if (si == NULL)
+    return;
+  for (g = si->thescore; g; g = g->next)
+    {
+      DenemoStaff *thestaff = (DenemoStaff *) g->data;
+      for (h = thestaff->themeasures; h; h = h->next)
+        {
+          free_measure ((DenemoMeasure *) h->data);
+          g_free (h->data);
+        }
+      g_list_free (thestaff->themeasures);
+      g_string_free (thestaff->denemo_name, TRUE);
+      if (thestaff->subpart)
+        g_string_free (thestaff->subpart, TRUE);
+      g_string_free (thestaff->lily_name, TRUE);
+      g_string_free (thestaff->midi_instrument, TRUE);
+      g_string_free (thestaff->device_port, TRUE);
+      free_detached_directives (thestaff->clef.directives);
+      free_detached_directives (thestaff->keysig.directives);
+      free_detached_directives (thestaff->timesig.directives);
+      free_detached_directives (thestaff->staff_directives);
+      free_detached_directives (thestaff->voice_directives);
+      g_list_free_full (thestaff->verse_views, g_free);       //snapshots hold the text of the verses, not the views
+      g_list_free_full (thestaff->sources, g_object_unref);     //none for a clone, but a movement swapped out by undo keeps its own
+      g_free (thestaff);
+    }
+  g_list_free (si->thescore);
+  g_list_free (si->measurewidths);
+  free_detached_directives (si->movementcontrol.directives);
+  free_detached_directives (si->layout.directives);
+  free_detached_directives (si->header.directives);
+  g_free (si);
+}
+
 
 
 
@@ -283,7 +283,7 @@ cuttobuffer (DenemoMovement * si, gboolean copyfirst)
     max;
   if (!si->markstaffnum)
     return;
-  take_snapshot ();
+  take_measures_snapshot (si->selection.firststaffmarked, si->selection.laststaffmarked, si->selection.firstmeasuremarked, si->selection.lastmeasuremarked);
   if (copyfirst)
     copytobuffer (si);
   gint staffs_removed_measures = 0;     // a count of removed measures in the case where multiple staffs are involved
@@ -973,16 +973,31 @@ redowrapper (DenemoAction * action, DenemoScriptParam * param)
   displayhelper (gui);
 }
 
+static gboolean
+same_position (DenemoPosition * a, DenemoPosition * b)
+{
+  return (a->movement == b->movement) && (a->staff == b->staff) && (a->measure == b->measure) && (a->object == b->object) && (a->appending == b->appending);
+}
+
 /* store the passed object as ACTION_CHANGE undo information */
-/* potentially we could optimize the storage of undo information by telescoping changes to the same object when the undo is staged, it would mean keeping a global note of whether the undo is currently staged. We would peek at the head of the queue and if it was an ACTION_CHANGE at the same position we could free the stored object and replace it with the clone created here */
+/* changes to the same object are telescoped when the undo is staged (e.g. within a script): if the head of the queue is already an ACTION_CHANGE at the same position
+   it holds the state of the object before this stage changed it, which is all that undo needs, so no further clone is stored */
 void
 store_for_undo_change (DenemoMovement * si, DenemoObject * curobj)
 {
   if (!si->undo_guard)
     {
+      DenemoPosition position;
+      get_position (si, &position);
+      if ((Denemo.project->undo_stage_depth > 0) && (Denemo.project->undo_stage_movement == si))
+        {
+          DenemoUndoData *last = g_queue_peek_head (si->undodata);
+          if (last && (last->action == ACTION_CHANGE) && same_position (&last->position, &position))
+            return;
+        }
       DenemoUndoData *data = (DenemoUndoData *) g_malloc (sizeof (DenemoUndoData));
       data->object = dnm_clone_object (curobj);
-      get_position (si, &data->position);
+      data->position = position;
       data->action = ACTION_CHANGE;
       update_undo_info (si, data);
     }
@@ -1001,6 +1016,37 @@ store_for_undo_measure_create (DenemoMovement * si, gint staffnum, gint measuren
     }
 }
 
+/* undo data for ACTION_MEASURES_SNAPSHOT: copies of a range of measures in a range of staffs.
+ * The measures outside the range are not copied, they are shared with the live movement.
+ * On undo/redo the saved measures are swapped with the live ones, so the snapshot then holds the other state. */
+typedef struct MeasuresSnapshot
+{
+  gint firststaff;              /* staff numbers start at 1 */
+  gint laststaff;
+  gint firstmeasure;            /* measure numbers start at 1 */
+  GList **measures;             /* for each staff the saved measures */
+  gint *following;              /* for each staff the number of measures after the range, these are unaffected by the change */
+} MeasuresSnapshot;
+
+static void
+free_measures_snapshot (MeasuresSnapshot * snap)
+{
+  gint i;
+  GList *g;
+  for (i = 0; i <= snap->laststaff - snap->firststaff; i++)
+    {
+      for (g = snap->measures[i]; g; g = g->next)
+        {
+          free_measure ((DenemoMeasure *) g->data);
+          g_free (g->data);
+        }
+      g_list_free (snap->measures[i]);
+    }
+  g_free (snap->measures);
+  g_free (snap->following);
+  g_free (snap);
+}
+
 static void
 free_chunk (DenemoUndoData * chunk)
 {
@@ -1030,7 +1076,11 @@ free_chunk (DenemoUndoData * chunk)
       g_free (chunk);
       break;
     case ACTION_SNAPSHOT:
-      g_warning ("Snapshot free is not implemented");
+      free_cloned_movement ((DenemoMovement *) chunk->object);
+      g_free (chunk);
+      break;
+    case ACTION_MEASURES_SNAPSHOT:
+      free_measures_snapshot ((MeasuresSnapshot *) chunk->object);
       g_free (chunk);
       break;
     default:
@@ -1038,19 +1088,182 @@ free_chunk (DenemoUndoData * chunk)
     }
 }
 
+/* approximate heap usage of undo information, used to keep the undo queue within Denemo.prefs.undo_memory_limit */
+static gsize
+object_memory (DenemoObject * obj)
+{
+  gsize size;
+  if (obj == NULL)
+    return 0;
+  size = sizeof (DenemoObject) + sizeof (GList) + g_list_length (obj->directives) * sizeof (DenemoDirective);
+  switch (obj->type)
+    {
+    case CHORD:
+      {
+        chord *thechord = (chord *) obj->object;
+        GList *g;
+        size += sizeof (chord) + g_list_length (thechord->directives) * sizeof (DenemoDirective);
+        for (g = thechord->notes; g; g = g->next)
+          size += sizeof (note) + sizeof (GList) + g_list_length (((note *) g->data)->directives) * sizeof (DenemoDirective);
+      }
+      break;
+    case LILYDIRECTIVE:
+      size += sizeof (DenemoDirective);
+      break;
+    default:
+      size += sizeof (gpointer) * 8;    //small fixed size structures
+      break;
+    }
+  return size;
+}
+
+static gsize
+measure_memory (DenemoMeasure * measure)
+{
+  gsize size = sizeof (DenemoMeasure) + sizeof (GList);
+  GList *g;
+  for (g = measure->objects; g; g = g->next)
+    size += object_memory ((DenemoObject *) g->data);
+  return size;
+}
+
+static gsize
+movement_memory (DenemoMovement * si)
+{
+  gsize size = sizeof (DenemoMovement);
+  GList *g, *h;
+  for (g = si->thescore; g; g = g->next)
+    {
+      size += sizeof (DenemoStaff) + sizeof (GList);
+      for (h = ((DenemoStaff *) g->data)->themeasures; h; h = h->next)
+        size += measure_memory ((DenemoMeasure *) h->data);
+    }
+  return size;
+}
+
+static gsize
+chunk_memory (DenemoUndoData * chunk)
+{
+  switch (chunk->action)
+    {
+    case ACTION_STAGE_START:
+    case ACTION_STAGE_END:
+    case ACTION_SCRIPT_ERROR:
+      return 0;                 //statically allocated
+    case ACTION_INSERT:
+    case ACTION_DELETE:
+    case ACTION_CHANGE:
+      return sizeof (DenemoUndoData) + object_memory (chunk->object);
+    case ACTION_MEASURE_DELETE:
+    case ACTION_MEASURE_INSERT:
+      return sizeof (DenemoUndoData) + (chunk->object ? measure_memory ((DenemoMeasure *) chunk->object) : 0);
+    case ACTION_SNAPSHOT:
+      return sizeof (DenemoUndoData) + movement_memory ((DenemoMovement *) chunk->object);
+    case ACTION_MEASURES_SNAPSHOT:
+      {
+        MeasuresSnapshot *snap = (MeasuresSnapshot *) chunk->object;
+        gsize size = sizeof (DenemoUndoData) + sizeof (MeasuresSnapshot);
+        gint i;
+        GList *g;
+        for (i = 0; i <= snap->laststaff - snap->firststaff; i++)
+          for (size += sizeof (GList *) + sizeof (gint), g = snap->measures[i]; g; g = g->next)
+            size += measure_memory ((DenemoMeasure *) g->data);
+        return size;
+      }
+    default:
+      return sizeof (DenemoUndoData);
+    }
+}
+
+/* return the number of entries at the head of the undo queue of si that belong to the open undo stage, 0 if none is open on si */
+static guint
+open_stage_length (DenemoMovement * si)
+{
+  DenemoProject *gui = Denemo.project;
+  gint open = 0, closed = 0;
+  guint length = 0;
+  GList *g;
+  if ((gui->undo_stage_depth == 0) || (gui->undo_stage_movement != si))
+    return 0;
+  for (g = si->undodata->head; g; g = g->next)
+    {
+      DenemoUndoData *chunk = g->data;
+      length++;
+      if (chunk->action == ACTION_STAGE_START)
+        closed++;
+      else if (chunk->action == ACTION_STAGE_END)
+        {
+          if (closed)
+            closed--;
+          else if (++open == gui->undo_stage_depth)
+            return length;
+        }
+    }
+  return length;
+}
+
+/* drop the oldest undo stages until the undo queue is within the user's memory limit.
+ * The most recent entry is always kept, as is the whole of the open stage if any.
+ * Stages are dropped whole, nested stages included. */
+static void
+trim_undo_queue (DenemoMovement * si)
+{
+  DenemoProject *gui = Denemo.project;
+  gsize limit = ((gsize) Denemo.prefs.undo_memory_limit) * 1024 * 1024;
+  guint keep;
+  if ((limit == 0) || (si->undo_memory <= limit))
+    return;
+  if (gui->undo_trim_blocked && (gui->undo_stage_movement == si))
+    return;                     //nothing older than the open stage is left, wait for it to end
+  keep = MAX (1, open_stage_length (si));
+  while ((si->undo_memory > limit) && (g_queue_get_length (si->undodata) > keep))
+    {
+      gint depth = 0;
+      do
+        {
+          DenemoUndoData *chunk = g_queue_pop_tail (si->undodata);
+          if (chunk->action == ACTION_STAGE_END)
+            depth++;
+          else if (chunk->action == ACTION_STAGE_START)
+            depth--;
+          si->undo_memory -= MIN (si->undo_memory, chunk_memory (chunk));
+          free_chunk (chunk);
+        }
+      while ((depth > 0) && (g_queue_get_length (si->undodata) > keep));
+    }
+  if ((si->undo_memory > limit) && gui->undo_stage_depth && (gui->undo_stage_movement == si))
+    gui->undo_trim_blocked = TRUE;
+  //g_debug ("Undo queue trimmed to %d entries, %" G_GSIZE_FORMAT " bytes", g_queue_get_length (si->undodata), si->undo_memory);
+}
+
 
 
 static DenemoUndoData ActionStageStart = { ACTION_STAGE_START };
 static DenemoUndoData ActionStageEnd = { ACTION_STAGE_END };
 static DenemoUndoData ActionScriptError = { ACTION_SCRIPT_ERROR };
 
+/* the open undo stages are counted on the project, as a script may change movement before its stage ends.
+ * The outermost stage is ended on the movement it was started on, if that still exists */
 void
 stage_undo (DenemoMovement * si, action_type type)
 {
+  DenemoProject *gui = Denemo.project;
+  if (Denemo.batch_level && ((type == ACTION_STAGE_START) || (type == ACTION_STAGE_END)))
+    return;                     //a batch of edits is staged as a whole
   switch (type)
     {
     case ACTION_STAGE_START:
       {
+        gboolean trim = FALSE;
+        if ((gui->undo_stage_depth > 0) && (--gui->undo_stage_depth == 0))
+          {
+            DenemoMovement *opened = gui->undo_stage_movement;
+            if (opened && ((opened == gui->movement) || g_list_find (gui->movements, opened)))
+              si = opened;
+            trim = gui->undo_trim_blocked;
+            gui->undo_trim_blocked = FALSE;
+            gui->undo_stage_movement = NULL;
+          }
         if (g_queue_is_empty (si->undodata))
           return;
         DenemoUndoData *chunk = g_queue_peek_head (si->undodata);
@@ -1062,9 +1275,13 @@ stage_undo (DenemoMovement * si, action_type type)
           }
         else
           update_undo_info (si, &ActionStageStart);
+        if (trim)
+          trim_undo_queue (si);   //the stage may now be dropped
       }
       break;
     case ACTION_STAGE_END:
+      if (gui->undo_stage_depth++ == 0)
+        gui->undo_stage_movement = si;
       update_undo_info (si, &ActionStageEnd);
       break;
     case ACTION_SCRIPT_ERROR:
@@ -1093,6 +1310,9 @@ get_last_change (DenemoMovement * si)
     case ACTION_SNAPSHOT:
       return g_strdup_printf ("Snapshot (e.g. measure delete, cut, paste and sadly many other things ... ");
       break;
+    case ACTION_MEASURES_SNAPSHOT:
+      return g_strdup_printf ("Change to measures from staff %d measure %d; ", ((MeasuresSnapshot *) last->object)->firststaff, ((MeasuresSnapshot *) last->object)->firstmeasure);
+      break;
     case ACTION_INSERT:
       return g_strdup_printf ("Insert the object at staff %d measure %d position %d; ", last->position.staff, last->position.measure, last->position.object + 1);
     case ACTION_DELETE:
@@ -1138,6 +1358,102 @@ take_snapshot (void)
     return FALSE;
 }
 
+/**
+ * take_measures_snapshot
+ * Snapshots measures firstmeasure to lastmeasure of staffs firststaff to laststaff of the current movement for undo.
+ * Only these measures are copied; the change being made must not alter other measures, though it may
+ * insert or remove measures within the range. If lastmeasure is less than firstmeasure nothing is copied,
+ * which serves for changes that only insert measures before firstmeasure.
+ * Returns FALSE if no snapshot was taken because of a guard.
+ */
+gboolean
+take_measures_snapshot (gint firststaff, gint laststaff, gint firstmeasure, gint lastmeasure)
+{
+  DenemoMovement *si = Denemo.project->movement;
+  MeasuresSnapshot *snap;
+  DenemoUndoData *chunk;
+  staffnode *curstaff;
+  gint i, numstaffs;
+  if (si->undo_guard)
+    return FALSE;
+  if ((firststaff < 1) || (laststaff > (gint) g_list_length (si->thescore)) || (firststaff > laststaff) || (firstmeasure < 1))
+    return take_snapshot ();
+  numstaffs = laststaff - firststaff + 1;
+  snap = (MeasuresSnapshot *) g_malloc (sizeof (MeasuresSnapshot));
+  snap->firststaff = firststaff;
+  snap->laststaff = laststaff;
+  snap->firstmeasure = firstmeasure;
+  snap->measures = g_new0 (GList *, numstaffs);
+  snap->following = g_new0 (gint, numstaffs);
+  for (i = 0, curstaff = g_list_nth (si->thescore, firststaff - 1); i < numstaffs; i++, curstaff = curstaff->next)
+    {
+      GList *g;
+      gint j;
+      gint nummeasures = g_list_length (((DenemoStaff *) curstaff->data)->themeasures);
+      gint last = MIN (lastmeasure, nummeasures);
+      for (j = firstmeasure, g = g_list_nth (((DenemoStaff *) curstaff->data)->themeasures, firstmeasure - 1); g && (j <= last); j++, g = g->next)
+        snap->measures[i] = g_list_prepend (snap->measures[i], clone_measure ((DenemoMeasure *) g->data));
+      snap->measures[i] = g_list_reverse (snap->measures[i]);
+      snap->following[i] = MAX (0, nummeasures - MAX (last, firstmeasure - 1));
+    }
+  chunk = (DenemoUndoData *) g_malloc (sizeof (DenemoUndoData));
+  chunk->object = (DenemoObject *) snap;
+  get_position (si, &chunk->position);
+  chunk->position.appending = 0;
+  chunk->action = ACTION_MEASURES_SNAPSHOT;
+  update_undo_info (si, chunk);
+  return TRUE;
+}
+
+/* exchange the measures held in snap with the corresponding live measures of the movement, leaving the live ones in snap */
+static void
+swap_measures_snapshot (DenemoMovement * si, MeasuresSnapshot * snap)
+{
+  staffnode *curstaff;
+  gint i, maxmeasures = 0;
+  for (i = 0, curstaff = g_list_nth (si->thescore, snap->firststaff - 1); curstaff && (i <= snap->laststaff - snap->firststaff); i++, curstaff = curstaff->next)
+    {
+      DenemoStaff *thestaff = (DenemoStaff *) curstaff->data;
+      gint nummeasures = g_list_length (thestaff->themeasures);
+      gint start = MIN (snap->firstmeasure - 1, nummeasures);   //index of the first live measure to swap out
+      gint end = MAX (start, nummeasures - snap->following[i]); //index of the first live measure after those
+      GList *after = g_list_nth (thestaff->themeasures, end);
+      GList *before = (start > 0) ? g_list_nth (thestaff->themeasures, start - 1) : NULL;
+      GList *range = (start < end) ? (before ? before->next : thestaff->themeasures) : NULL;
+      GList *saved = snap->measures[i];
+      if (range)
+        {
+          GList *rangelast = after ? after->prev : g_list_last (range);
+          rangelast->next = NULL;
+          range->prev = NULL;
+        }
+      if (saved)
+        {
+          GList *savedlast = g_list_last (saved);
+          saved->prev = before;
+          savedlast->next = after;
+          if (after)
+            after->prev = savedlast;
+        }
+      else if (after)
+        after->prev = before;
+      if (before)
+        before->next = saved ? saved : after;
+      else
+        thestaff->themeasures = saved ? saved : after;
+      snap->measures[i] = range;
+      if (thestaff->themeasures == NULL)
+        thestaff->themeasures = g_list_append (NULL, g_malloc0 (sizeof (DenemoMeasure)));
+      thestaff->nummeasures = g_list_length (thestaff->themeasures);
+    }
+  for (curstaff = si->thescore; curstaff; curstaff = curstaff->next)
+    maxmeasures = MAX (maxmeasures, (gint) g_list_length (((DenemoStaff *) curstaff->data)->themeasures));
+  while ((gint) g_list_length (si->measurewidths) < maxmeasures)
+    si->measurewidths = g_list_append (si->measurewidths, GINT_TO_POINTER (si->measurewidth));
+  while ((gint) g_list_length (si->measurewidths) > maxmeasures)
+    si->measurewidths = g_list_delete_link (si->measurewidths, g_list_last (si->measurewidths));
+}
+
 static void
 print_queue (gchar * msg, GQueue * q)
 {
@@ -1157,6 +1473,9 @@ print_queue (gchar * msg, GQueue * q)
         case ACTION_SNAPSHOT:
           g_print ("Snapshot; ");
           break;
+        case ACTION_MEASURES_SNAPSHOT:
+          g_print ("Measures Snapshot; ");
+          break;
         case ACTION_INSERT:
           g_print ("Ins; ");
           break;
@@ -1335,6 +1654,7 @@ action_chunk (DenemoProject * gui, DenemoUndoData ** pchunk)
         DenemoMovement *si = (DenemoMovement *) chunk->object;
         gint initial_guard = gui->movement->undo_guard;
         gint initial_changecount = gui->movement->changecount;
+        gsize initial_undo_memory = gui->movement->undo_memory;
         gboolean initial_redo_invalid = gui->movement->redo_invalid;
         gpointer initial_smf = gui->movement->smf;
         // replace gui->movement in gui->movements with si
@@ -1419,6 +1739,8 @@ action_chunk (DenemoProject * gui, DenemoUndoData ** pchunk)
             chunk->object = (DenemoObject *) gui->movement;
             //FIXME fix up other values in stored object si?????? voice/staff directive widgets
             gui->movement = si;
+            if (gui->undo_stage_movement == (DenemoMovement *) chunk->object)
+              gui->undo_stage_movement = si;
             for (curstaff = si->thescore; curstaff; curstaff = curstaff->next)
               {
                 DenemoStaff *thestaff = curstaff->data;
@@ -1494,6 +1816,7 @@ action_chunk (DenemoProject * gui, DenemoUndoData ** pchunk)
             gui->movement->redo_invalid = initial_redo_invalid;
             gui->movement->undo_guard = initial_guard;        //we keep all the guards we had on entry which will be removed when
             gui->movement->changecount = initial_changecount;
+            gui->movement->undo_memory = initial_undo_memory;
             position_for_chunk (gui, chunk);// !!!!! this doesn't call goto_movement_staff_obj   //FIXME check return val
             setcurrents (Denemo.project->movement);
             if (!gui->movement->currentmeasure)
@@ -1520,6 +1843,28 @@ action_chunk (DenemoProject * gui, DenemoUndoData ** pchunk)
           }
       }
       break;
+    case ACTION_MEASURES_SNAPSHOT:
+      {
+        MeasuresSnapshot *snap = (MeasuresSnapshot *) chunk->object;
+        staffnode *curstaff;
+        gint i;
+        swap_measures_snapshot (gui->movement, snap);
+        cache_all ();
+        for (i = snap->firststaff, curstaff = g_list_nth (gui->movement->thescore, snap->firststaff - 1); curstaff && (i <= snap->laststaff); i++, curstaff = curstaff->next)
+          {
+            staff_fix_note_heights ((DenemoStaff *) curstaff->data);
+            staff_show_which_accidentals ((DenemoStaff *) curstaff->data);
+            staff_beams_and_stems_dirs ((DenemoStaff *) curstaff->data);
+          }
+        if (!goto_movement_staff_obj (NULL /*non-interactive */ , -1, chunk->position.staff, chunk->position.measure, chunk->position.object, chunk->position.leftmeasurenum))
+          {
+            setcurrents (gui->movement);
+            movetoend (NULL, NULL);
+          }
+        XesNeedRecalculating = TRUE;
+        signal_structural_change (gui);
+      }
+      break;
     case ACTION_NOOP:
       break;
 
@@ -1573,6 +1918,7 @@ undo (DenemoProject * gui)
   DenemoUndoData *chunk = (DenemoUndoData *) g_queue_pop_head (gui->movement->undodata);
   if (chunk)
     {
+      gui->movement->undo_memory -= MIN (gui->movement->undo_memory, chunk_memory (chunk));
       gui->movement->undo_guard++;
       //g_debug("undo %d\n", chunk->action);
       if (position_for_chunk (gui, chunk))
@@ -1584,6 +1930,7 @@ undo (DenemoProject * gui)
           position_warning (chunk);
           free_queue (gui->movement->redodata);
           free_queue (gui->movement->undodata);
+          gui->movement->undo_memory = 0;
           warn_no_more_undo (gui);      //returns guard to user preference and sets level 0
           return;
         }
@@ -1667,6 +2014,8 @@ update_undo_info (DenemoMovement * si, DenemoUndoData * undo)
   //   }
 
   g_queue_push_head (si->undodata, undo);
+  si->undo_memory += chunk_memory (undo);
+  trim_undo_queue (si);
   si->redo_invalid = TRUE;
   // print_queue("\nUpdate Undo, queue:", si->undodata);
 }
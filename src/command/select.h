@@ -57,6 +57,7 @@ void update_undo_info (DenemoMovement * si, DenemoUndoData * undo);
 void update_redo_info (DenemoMovement * si, DenemoUndoData * redo);
 void store_for_undo_change (DenemoMovement * si, DenemoObject * obj);
 gboolean take_snapshot (void);
+gboolean take_measures_snapshot (gint firststaff, gint laststaff, gint firstmeasure, gint lastmeasure);
 void stage_undo (DenemoMovement * si, action_type type);
 
 void goto_mark (DenemoAction * action, DenemoScriptParam * param);
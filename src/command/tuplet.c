@@ -25,7 +25,7 @@ tuplet_open_new (gint numerator, gint denominator)
 {
   DenemoObject *tuplet;
   tupopen *newtup = (tupopen *) g_malloc (sizeof (tupopen));
-  tuplet = (DenemoObject *) g_malloc (sizeof (DenemoObject));
+  tuplet = (DenemoObject *) g_malloc0 (sizeof (DenemoObject));
   tuplet->type = TUPOPEN;
   newtup->numerator = numerator;
   newtup->denominator = denominator;
@@ -41,7 +41,7 @@ tuplet_close_new ()
 {
   DenemoObject *tuplet;
   tupopen *newtup = (tupopen *) g_malloc (sizeof (tupopen));    //avoids a null object
-  tuplet = (DenemoObject *) g_malloc (sizeof (DenemoObject));
+  tuplet = (DenemoObject *) g_malloc0 (sizeof (DenemoObject));
   tuplet->type = TUPCLOSE;
   tuplet->object = newtup;      //avoids a null object
   set_basic_numticks (tuplet);
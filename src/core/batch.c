@@ -0,0 +1,325 @@
+/*
+ * batch.c
+ *
+ * converting many scores with one start up of Denemo (denemo --batch manifest)
+ *
+ * this is part of the GNU Denemo
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <glib/gstdio.h>
+#include <denemo/denemo.h>
+
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
+#include "core/batch.h"
+#include "core/utils.h"
+#include "core/exportxml.h"
+#include "export/file.h"
+#include "export/print.h"
+#include "export/exportlilypond.h"
+#include "export/exportmidi.h"
+#include "export/exportmusicxml.h"
+
+typedef struct BatchItem
+{
+  gchar *input;
+  gchar *output;                //the format is given by the extension
+  gboolean done;
+  gboolean ok;
+  gdouble seconds;
+  gchar *error;
+} BatchItem;
+
+static void
+free_batch_item (BatchItem * item)
+{
+  g_free (item->input);
+  g_free (item->output);
+  g_free (item->error);
+  g_free (item);
+}
+
+static gchar *
+manifest_path (gchar * dir, gchar * path)
+{
+  path = g_strstrip (path);
+  return g_path_is_absolute (path) ? g_strdup (path) : g_build_filename (dir, path, NULL);
+}
+
+/* read the manifest, one conversion per line "input<TAB>output", blank lines and lines starting # ignored.
+ * Relative paths are relative to the manifest. Returns NULL if it cannot be read.
+ */
+static GPtrArray *
+read_manifest (gchar * manifest)
+{
+  gchar *contents;
+  gchar **lines, **line;
+  gchar *dir;
+  GPtrArray *items;
+  if (!g_file_get_contents (manifest, &contents, NULL, NULL))
+    return NULL;
+  dir = g_path_get_dirname (manifest);
+  items = g_ptr_array_new_with_free_func ((GDestroyNotify) free_batch_item);
+  lines = g_strsplit (contents, "\n", -1);
+  for (line = lines; *line; line++)
+    {
+      gchar *text = g_strstrip (*line);
+      gchar *tab = strchr (text, '\t');
+      if ((*text == 0) || (*text == '#'))
+        continue;
+      if (tab == NULL)
+        {
+          g_warning ("Batch manifest line \"%s\" has no tab between input and output, skipped", text);
+          continue;
+        }
+      *tab = 0;
+      BatchItem *item = (BatchItem *) g_malloc0 (sizeof (BatchItem));
+      item->input = manifest_path (dir, text);
+      item->output = manifest_path (dir, tab + 1);
+      g_ptr_array_add (items, item);
+    }
+  g_strfreev (lines);
+  g_free (dir);
+  g_free (contents);
+  return items;
+}
+
+/* convert the input of item to its output, returning NULL on success or what went wrong */
+static const gchar *
+convert_score (BatchItem * item)
+{
+  DenemoProject *gui = Denemo.project;
+  gchar *output = g_ascii_strdown (item->output, -1);
+  const gchar *error = NULL;
+  if (open_for_real (item->input, gui, FALSE, REPLACE_SCORE))
+    error = "could not open the score";
+  else
+    {
+      g_unlink (item->output);
+      gui->movement->markstaffnum = 0;
+      if (g_str_has_suffix (output, ".pdf"))
+        {
+          gchar *basename = g_strndup (item->output, strlen (item->output) - strlen (".pdf"));
+          export_pdf (basename, gui);
+          g_free (basename);
+        }
+      else if (g_str_has_suffix (output, ".mid") || g_str_has_suffix (output, ".midi"))
+        exportmidi (item->output, gui->movement);
+      else if (g_str_has_suffix (output, ".xml") || g_str_has_suffix (output, ".musicxml")
+               || g_str_has_suffix (output, ".mxl"))
+        exportmusicXML (item->output, gui);
+      else if (g_str_has_suffix (output, ".ly"))
+        exportlilypond (item->output, gui, TRUE);
+      else if (g_str_has_suffix (output, ".denemo"))
+        exportXML (item->output, gui);
+      else
+        error = "unknown output format";
+      if ((error == NULL) && !g_file_test (item->output, G_FILE_TEST_EXISTS))
+        error = "no output was written";
+    }
+  g_free (output);
+  return error;
+}
+
+static void
+run_batch_item (BatchItem * item)
+{
+  gint64 start = g_get_monotonic_time ();
+  const gchar *error = convert_score (item);
+  item->seconds = (g_get_monotonic_time () - start) / 1000000.0;
+  item->ok = (error == NULL);
+  item->error = g_strdup (error);
+  item->done = TRUE;
+}
+
+#ifndef G_OS_WIN32
+/* in a process forked from Denemo, make the conversions whose indexes are read from queue,
+ * writing "index<TAB>ok<TAB>seconds<TAB>error" lines to the file results
+ */
+static void
+run_batch_worker (GPtrArray * items, gint queue, gchar * results)
+{
+  FILE *fp = fopen (results, "w");
+  guint32 index;
+  renew_printdir ();            //the LilyPond files of each worker are kept apart
+  initialize_print_status ();
+  while (fp && (read (queue, &index, sizeof (index)) == sizeof (index)) && (index < items->len))
+    {
+      BatchItem *item = (BatchItem *) g_ptr_array_index (items, index);
+      run_batch_item (item);
+      fprintf (fp, "%u\t%d\t%f\t%s\n", index, item->ok, item->seconds, item->error ? item->error : "");
+      fflush (fp);
+    }
+  if (fp)
+    fclose (fp);
+  removeprintdir ();
+  _exit (0);
+}
+
+static void
+read_batch_results (GPtrArray * items, gchar * results)
+{
+  gchar *contents;
+  gchar **lines, **line;
+  if (!g_file_get_contents (results, &contents, NULL, NULL))
+    return;
+  lines = g_strsplit (contents, "\n", -1);
+  for (line = lines; *line; line++)
+    {
+      gchar **fields = g_strsplit (*line, "\t", 4);
+      if (g_strv_length (fields) == 4)
+        {
+          guint index = (guint) g_ascii_strtoull (fields[0], NULL, 10);
+          if (index < items->len)
+            {
+              BatchItem *item = (BatchItem *) g_ptr_array_index (items, index);
+              item->done = TRUE;
+              item->ok = atoi (fields[1]);
+              item->seconds = g_ascii_strtod (fields[2], NULL);
+              item->error = *fields[3] ? g_strdup (fields[3]) : NULL;
+            }
+        }
+      g_strfreev (fields);
+    }
+  g_strfreev (lines);
+  g_free (contents);
+}
+
+/* make the conversions in jobs processes forked from this one, so that each starts with Denemo loaded.
+ * The conversions are handed out through a pipe so that a process takes the next one when it is free.
+ */
+static void
+run_batch_workers (GPtrArray * items, gint jobs)
+{
+  GPid *pids = g_new (GPid, jobs);
+  gchar **results = g_new0 (gchar *, jobs + 1);
+  gint queue[2];
+  guint32 index;
+  gint i;
+  if (pipe (queue))
+    {
+      g_warning ("Could not create the batch queue, converting one at a time");
+      for (index = 0; index < items->len; index++)
+        run_batch_item ((BatchItem *) g_ptr_array_index (items, index));
+      g_free (pids);
+      g_free (results);
+      return;
+    }
+  signal (SIGPIPE, SIG_IGN);    //if all the workers die writing to the queue fails rather than killing us
+  fflush (NULL);
+  for (i = 0; i < jobs; i++)
+    {
+      results[i] = g_strdup_printf ("%s%cbatch-%d.txt", locateprintdir (), G_DIR_SEPARATOR, i);
+      pids[i] = fork ();
+      if (pids[i] == 0)
+        {
+          close (queue[1]);
+          run_batch_worker (items, queue[0], results[i]);
+        }
+      if (pids[i] < 0)
+        g_warning ("Could not start batch worker %d", i);
+    }
+  close (queue[0]);
+  for (index = 0; index < items->len; index++)
+    if (write (queue[1], &index, sizeof (index)) != sizeof (index))
+      break;
+  close (queue[1]);
+  for (i = 0; i < jobs; i++)
+    {
+      if (pids[i] > 0)
+        waitpid (pids[i], NULL, 0);
+      read_batch_results (items, results[i]);
+      g_unlink (results[i]);
+    }
+  g_strfreev (results);
+  g_free (pids);
+}
+#endif
+
+static void
+append_json_string (GString * json, const gchar * str)
+{
+  g_string_append_c (json, '"');
+  for (; *str; str++)
+    {
+      if ((*str == '"') || (*str == '\\'))
+        g_string_append_printf (json, "\\%c", *str);
+      else if ((guchar) * str < 0x20)
+        g_string_append_printf (json, "\\u%04x", (guchar) * str);
+      else
+        g_string_append_c (json, *str);
+    }
+  g_string_append_c (json, '"');
+}
+
+/* Make the conversions listed in the file manifest, jobs at a time (0 for one per processor),
+ * and write a JSON report of how long each took and which failed to report, or to standard output if NULL.
+ * Returns the exit status for Denemo, non-zero if any conversion failed.
+ */
+gint
+run_batch (gchar * manifest, gchar * report, gint jobs)
+{
+  GPtrArray *items = read_manifest (manifest);
+  gint64 start = g_get_monotonic_time ();
+  GString *json;
+  gint failed = 0;
+  guint i;
+  if (items == NULL)
+    {
+      g_critical ("Could not read the batch manifest %s", manifest);
+      return 1;
+    }
+  if (jobs <= 0)
+#if GLIB_CHECK_VERSION(2,36,0)
+    jobs = g_get_num_processors ();
+#else
+    jobs = 1;
+#endif
+  if (jobs > (gint) items->len)
+    jobs = items->len;
+#ifndef G_OS_WIN32
+  if (jobs > 1)
+    run_batch_workers (items, jobs);
+  else
+#endif
+    for (i = 0; i < items->len; i++)
+      run_batch_item ((BatchItem *) g_ptr_array_index (items, i));
+
+  json = g_string_new ("{\n  \"conversions\": [");
+  for (i = 0; i < items->len; i++)
+    {
+      BatchItem *item = (BatchItem *) g_ptr_array_index (items, i);
+      if (!item->done)
+        item->error = g_strdup ("the conversion stopped Denemo");
+      if (!item->ok)
+        failed++;
+      g_string_append (json, i ? ",\n    {\"input\": " : "\n    {\"input\": ");
+      append_json_string (json, item->input);
+      g_string_append (json, ", \"output\": ");
+      append_json_string (json, item->output);
+      g_string_append_printf (json, ", \"ok\": %s, \"seconds\": %.3f", item->ok ? "true" : "false", item->seconds);
+      if (item->error)
+        {
+          g_string_append (json, ", \"error\": ");
+          append_json_string (json, item->error);
+        }
+      g_string_append_c (json, '}');
+    }
+  g_string_append_printf (json, "\n  ],\n  \"jobs\": %d,\n  \"failed\": %d,\n  \"seconds\": %.3f\n}\n", jobs, failed,
+                          (g_get_monotonic_time () - start) / 1000000.0);
+  if (report == NULL)
+    fputs (json->str, stdout);
+  else if (!g_file_set_contents (report, json->str, -1, NULL))
+    g_critical ("Could not write the batch report %s", report);
+  g_string_free (json, TRUE);
+  g_ptr_array_free (items, TRUE);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,6 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+gint run_batch (gchar * manifest, gchar * report, gint jobs);
+
+#endif
@@ -144,6 +144,9 @@ process_command_line (int argc, char **argv, gboolean gtkstatus)
     { "silent",              'm', 0, G_OPTION_ARG_NONE, &Denemo.silent, _("Don't log any message"), NULL },
     { "verbose",             'V', 0, G_OPTION_ARG_NONE, &Denemo.verbose, _("Display every messages"), NULL },
     { "non-interactive",     'n', 0, G_OPTION_ARG_NONE, &Denemo.non_interactive, _("Launch Denemo without GUI"), NULL },
+    { "batch",               'b', 0, G_OPTION_ARG_FILENAME, &Denemo.batch_manifest, _("Without GUI, make the conversions listed in manifest, one \"input<TAB>output\" per line"), _("manifest") },
+    { "batch-report",        0,   0, G_OPTION_ARG_FILENAME, &Denemo.batch_report, _("Write the JSON report on the batch conversions to file instead of standard output"), _("file") },
+    { "jobs",                'j', 0, G_OPTION_ARG_INT, &Denemo.batch_jobs, _("Number of batch conversions to make at once (default one per processor)"), _("n") },
     { "version",             'v', 0, G_OPTION_ARG_NONE, &version,  _("Print version information and exit"), NULL },
     { "audio-options",       'A', G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &Denemo.prefs.audio_driver,_("Audio driver options"), _("options") },
     { "midi-options",        'M', G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &Denemo.prefs.midi_driver, _("Midi driver options"), _("options") },
@@ -196,7 +199,7 @@ process_command_line (int argc, char **argv, gboolean gtkstatus)
 #endif
 
   //Set command line mode if gtk could not be initialized
-  if(!gtkstatus)
+  if(!gtkstatus || Denemo.batch_manifest)
     Denemo.non_interactive = TRUE;
 
   return filenames;
@@ -151,6 +151,9 @@ initprefs (void)
   ret->autosave_timeout = 5;
   ret->compression = 3;
   ret->maxhistory = 20;
+  ret->undo_memory_limit = 256;
+  ret->typeset_cache_size = 64;
+  ret->max_typeset_jobs = 0;
   ret->midi_in_controls = FALSE;
   ret->playback_controls = FALSE;
   ret->toolbar = TRUE;
@@ -325,6 +328,9 @@ parseConfig (xmlDocPtr doc, xmlNodePtr cur, DenemoPrefs * prefs)
         READBOOLXMLENTRY (autosave)
         READINTXMLENTRY (autosave_timeout)
         READINTXMLENTRY (maxhistory)
+        READINTXMLENTRY (undo_memory_limit)
+        READINTXMLENTRY (typeset_cache_size)
+        READINTXMLENTRY (max_typeset_jobs)
 
 
         READBOOLXMLENTRY (immediateplayback)
@@ -788,6 +794,9 @@ writeXMLPrefs (DenemoPrefs * prefs)
     WRITEBOOLXMLENTRY (autosave)
     WRITEINTXMLENTRY (autosave_timeout)
     WRITEINTXMLENTRY (maxhistory)
+    WRITEINTXMLENTRY (undo_memory_limit)
+    WRITEINTXMLENTRY (typeset_cache_size)
+    WRITEINTXMLENTRY (max_typeset_jobs)
     WRITEBOOLXMLENTRY (saveparts)
     WRITEBOOLXMLENTRY (createclones)
     WRITEBOOLXMLENTRY (spillover)
@@ -209,9 +209,9 @@ void localization_init (void)
 // created or the existing temporary directory will
 // be returned.
 // If removal is TRUE, the directory gets removed and NULL is returned.
+static gchar *tmpdir = NULL;
 gchar *make_temp_dir (gboolean removal)
 {
-  static gchar *tmpdir = NULL;
   if (!removal)
     {
       // Either create a new directory or get the path
@@ -266,6 +266,13 @@ removeprintdir (void)
   make_temp_dir (TRUE);
 }
 
+// Use a new temporary directory from now on, for a process forked from this one
+void
+renew_printdir (void)
+{
+  tmpdir = NULL;
+}
+
 void copy_file (gchar *source_file, gchar *dest_file)
 {
 	GError *error = NULL;
@@ -458,6 +465,7 @@ typedef struct _ProgressData
   GtkWidget *pbar;
   int timer;
   gboolean progressing;
+  gulong delete_handler;        //the delete-event handler connected by the latest call to progressbar ()
 } ProgressData;
 
 static ProgressData progress_data;
@@ -518,17 +526,32 @@ progressbar (gchar * msg, gpointer callback)
     pdata->timer = g_timeout_add (100, (GSourceFunc) progress_timeout, pdata);
   pdata->progressing = TRUE;    /* If this is false the progress bar will stop */
   gtk_widget_show (pdata->window);
-  /* If widget is destroyed stop the printing */
+  /* If widget is destroyed stop the printing, only the handler for the latest caller is kept */
+  if (pdata->delete_handler)
+    g_signal_handler_disconnect (G_OBJECT (pdata->window), pdata->delete_handler);
   if (callback)
-    g_signal_connect (G_OBJECT (pdata->window), "delete-event", G_CALLBACK (callback /*call_stop_lilypond */ ), NULL);
+    pdata->delete_handler = g_signal_connect (G_OBJECT (pdata->window), "delete-event", G_CALLBACK (callback /*call_stop_lilypond */ ), NULL);
   else
-    g_signal_connect (G_OBJECT (pdata->window), "delete-event", G_CALLBACK (progressbar_stop), NULL);
+    pdata->delete_handler = g_signal_connect (G_OBJECT (pdata->window), "delete-event", G_CALLBACK (progressbar_stop), NULL);
   return GTK_WINDOW (pdata->window);
 }
 void
 progressbar_stop (void)
 {
   progress_data.progressing = FALSE;
+  if (progress_data.delete_handler)
+    {
+      g_signal_handler_disconnect (G_OBJECT (progress_data.window), progress_data.delete_handler);
+      progress_data.delete_handler = 0;
+    }
+}
+
+/* change the message shown by the progress bar started with progressbar () */
+void
+progressbar_message (gchar * msg)
+{
+  if (progress_data.pbar)
+    gtk_progress_bar_set_text (GTK_PROGRESS_BAR (progress_data.pbar), msg);
 }
 
 void keep_alive (void)
@@ -1968,7 +1991,9 @@ score_status (DenemoProject * gui, gboolean change)
       if (!Denemo.non_interactive)
         stop_editing_timer ();
     }
-  if (!Denemo.non_interactive)
+  if (Denemo.batch_level)
+    Denemo.batch_pending = TRUE;  //title bar and status are refreshed at the end of the batch
+  else if (!Denemo.non_interactive)
     {
       set_title_bar (gui);
       write_status (gui);
@@ -2357,7 +2382,7 @@ void truncate_label (GtkWidget *label, gchar *str)
 void
 write_status (DenemoProject * gui)
 {
-  if (Denemo.non_interactive)
+  if (Denemo.non_interactive || Denemo.batch_level)
     return;
 
   gint minutes = 0;
@@ -33,6 +33,7 @@ const gchar *get_user_data_dir (gboolean create);
 
 const gchar *locateprintdir (void);
 void removeprintdir (void);
+void renew_printdir (void);
 /* Adds a callback that processes the "activate" signal coming from
  * a widget */
 
@@ -107,6 +108,7 @@ GtkWidget *infodialog (gchar * msg);
 
 GtkWindow *progressbar (gchar * msg, gpointer callback);
 void progressbar_stop (void);
+void progressbar_message (gchar * msg);
 void keep_alive (void);
 void busy_cursor (GtkWidget * area);
 void normal_cursor (GtkWidget * area);
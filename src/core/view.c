@@ -44,6 +44,7 @@
 #include "command/scorelayout.h"
 #include "core/keymapio.h"
 #include "core/menusystem.h"
+#include "core/batch.h"
 #include "command/measure.h"
 #include "export/audiofile.h"
 #include "export/guidedimportmidi.h"
@@ -671,6 +672,14 @@ inner_main (void *files)
     if(!Denemo.non_interactive)
       readHistory ();
 
+    if (Denemo.batch_manifest) //conversions only, with the start up done once for all of them
+      {
+        Denemo.project = new_project (TRUE);
+        gint status = run_batch (Denemo.batch_manifest, Denemo.batch_report, Denemo.batch_jobs);
+        removeprintdir ();
+        exit (status);
+      }
+
  
 
     gboolean file_loaded = load_files (files);
@@ -28,6 +28,7 @@
 #include "display/displayanimation.h"
 #include "ui/moveviewport.h"
 #include "audio/audiointerface.h"
+#include "source/sourceaudio.h"
 
 #define EXCL_WIDTH 3
 #define EXCL_HEIGHT 13
@@ -386,6 +387,28 @@ draw_object (cairo_t * cr, objnode * curobj, gint x, gint y, DenemoProject * gui
 
             cairo_fill (cr);
 
+//draw the audio waveform over the extent of the note, from the peaks at the nearest resolution
+            if((si->recording->type == DENEMO_RECORDING_AUDIO) && si->recording->peaks && (notewidth > 0) && (next > current))
+                {
+                    float *mins = g_new (float, 2 * notewidth);
+                    float *maxs = mins + notewidth;
+                    gint p;
+                    if(get_audio_peaks (si->recording, (gint64)current + leadin, (next - current)/(gdouble)notewidth, notewidth, mins, maxs))
+                        {
+                            cairo_save (cr);
+                            cairo_set_source_rgba (cr, 0.4, 0.4, 0.4, 0.5);
+                            cairo_set_line_width (cr, 1.0);
+                            for(p = 0; p < notewidth; p++)
+                                {
+                                    cairo_move_to (cr, -extra_width + x + mudelaitem->x + p + 0.5, 17 - 10*maxs[p]);
+                                    cairo_line_to (cr, -extra_width + x + mudelaitem->x + p + 0.5, 17 - 10*mins[p]);
+                                }
+                            cairo_stroke (cr);
+                            cairo_restore (cr);
+                        }
+                    g_free (mins);
+                }
+
 			leadin-=5;//to allow for rounding errors...
 
             cairo_set_source_rgba (cr, 0.1, 0.1, 0.1, 0.9);
@@ -19,14 +19,19 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <sndfile.h>
 #include <fcntl.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include "export/audiofile.h"
 #include "export/file.h"
 #include "core/prefops.h"
 #include "core/utils.h"
+#include "audio/fluid.h"
+#include "audio/midi.h"
+#include "smf.h"
 
 const gchar *
 recorded_audio_filename (void)
@@ -37,80 +42,672 @@ recorded_audio_filename (void)
   return filename;
 }
 
+static gint recorded_rate = 44100;
+
+/* the sample rate at which the audio is being recorded */
+void
+set_recorded_audio_samplerate (gint rate)
+{
+  recorded_rate = rate;
+}
+
+#define EXPORT_BLOCK (65536)    //frames converted and written at a time
+
+typedef struct AudioExport
+{
+  FILE *in;
+  SNDFILE *out;
+  gint64 total;                 //frames in the recording
+  gint percent;                 //progress, set on the exporting thread
+  gint finished;
+  gint cancelled;               //set when the user closes the progress bar
+  gboolean ok;
+} AudioExport;
+
+static AudioExport *exporting = NULL;   //the export the progress bar is showing
+
+static gboolean
+cancel_audio_export (void)
+{
+  if (exporting)
+    g_atomic_int_set (&exporting->cancelled, TRUE);
+  progressbar_stop ();
+  return TRUE;
+}
+
+/* convert the mono floats of the recording to stereo frames in blocks, dropping any silence at the start */
+static gpointer
+export_audio_thread (AudioExport * export)
+{
+  float *in = g_new (float, EXPORT_BLOCK);
+  float *out = g_new (float, 2 * EXPORT_BLOCK);
+  gboolean silence = TRUE;
+  gint64 frames = 0;
+  size_t n;
+  export->ok = TRUE;
+  while ((n = fread (in, sizeof (float), EXPORT_BLOCK, export->in)) > 0)
+    {
+      if (g_atomic_int_get (&export->cancelled))
+        {
+          export->ok = FALSE;
+          break;
+        }
+      size_t i = 0, j;
+      if (silence)
+        {
+          while ((i < n) && (fabs (in[i]) < 0.0001))
+            i++;
+          silence = (i == n);
+        }
+      for (j = 0; i < n; i++, j++)
+        out[2 * j] = out[2 * j + 1] = in[i];
+      if (j && (sf_writef_float (export->out, out, j) != (sf_count_t) j))
+        {
+          export->ok = FALSE;
+          break;
+        }
+      frames += n;
+      g_atomic_int_set (&export->percent, (gint) (100 * frames / MAX (export->total, 1)));
+    }
+  g_free (in);
+  g_free (out);
+  g_atomic_int_set (&export->finished, TRUE);
+  return NULL;
+}
+
+static gint audio_format (const gchar * filename);
+
 gboolean
 export_recorded_audio (const gchar *outname)
 {
   const gchar *filename = recorded_audio_filename ();
+  GStatBuf buf;
+  AudioExport export;
   SF_INFO out;
-  if (filename)
-    {
-      gsize length;
-      float *data;
-      if (g_file_get_contents (filename, (gchar **)&data, &length, NULL) && (length>0))
-        {
-		  gchar *outfile;
-		  GList *exts = g_list_append (NULL, "*.ogg");
-		  exts = g_list_append (exts, "*.wav");
-          if (outname==NULL)
-			outfile = file_dialog ("Give output audio file name, with .ogg or .wav extension", FALSE, Denemo.prefs.denemopath->str, NULL, exts);
-		  else
-			outfile = g_strdup (outname);
-		  g_list_free (exts);
-          if (outfile)
+  gchar *outfile;
+  GList *exts;
+  GThread *thread;
+  if ((g_stat (filename, &buf) != 0) || (buf.st_size < (goffset) sizeof (float)))
+    {
+      if (Denemo.prefs.maxrecordingtime)
+        warningdialog (_("No audio recording has been made.\nSee Playback Controls - Record Button"));
+      else
+        warningdialog (_("The preference set for recording time is 0 - nothing is recorded.\nSee Edit → Change Preferences Audio/Midi Tab"));
+      return FALSE;
+    }
+  exts = g_list_append (NULL, "*.ogg");
+  exts = g_list_append (exts, "*.wav");
+  exts = g_list_append (exts, "*.flac");
+  if (outname == NULL)
+    outfile = file_dialog ("Give output audio file name, with .ogg, .wav or .flac extension", FALSE, Denemo.prefs.denemopath->str, NULL, exts);
+  else
+    outfile = g_strdup (outname);
+  g_list_free (exts);
+  if (outfile == NULL)
+    return FALSE;
+
+  memset (&export, 0, sizeof (export));
+  memset (&out, 0, sizeof (out));
+  out.format = audio_format (outfile);
+  out.channels = 2;
+  out.samplerate = recorded_rate;
+  export.total = buf.st_size / sizeof (float);
+  export.in = g_fopen (filename, "rb");
+  export.out = export.in ? sf_open (outfile, SFM_WRITE, &out) : NULL;
+  if (export.out == NULL)
+    {
+      g_warning ("Unable to open file %s for writing this format", outfile);
+      if (export.in)
+        fclose (export.in);
+      g_free (outfile);
+      return FALSE;
+    }
+  thread = g_thread_try_new ("Audio export", (GThreadFunc) export_audio_thread, &export, NULL);
+  if (thread == NULL)
+    export_audio_thread (&export);
+  else if (Denemo.non_interactive)
+    g_thread_join (thread);
+  else
+    {
+      gint percent = 0;
+      gchar *msg = g_strdup_printf (_("Saving audio .. %d%%"), percent);
+      exporting = &export;
+      progressbar (msg, cancel_audio_export);      //created once, as each call adds a handler to the window
+      g_free (msg);
+      while (!g_atomic_int_get (&export.finished))
+        {
+          if (percent != g_atomic_int_get (&export.percent))
+            {
+              percent = g_atomic_int_get (&export.percent);
+              msg = g_strdup_printf (_("Saving audio .. %d%%"), percent);
+              progressbar_message (msg);
+              g_free (msg);
+            }
+          keep_alive ();
+          g_usleep (50000);
+        }
+      g_thread_join (thread);
+      exporting = NULL;
+      progressbar_stop ();
+    }
+  fclose (export.in);
+  if (sf_close (export.out))
+    export.ok = FALSE;
+  if (export.cancelled)
+    {
+      g_unlink (outfile);
+      g_message ("Saving the audio to %s was cancelled", outfile);
+    }
+  else if (!export.ok)
+    g_warning ("Writing the audio to %s failed", outfile);
+  g_free (outfile);
+  return export.ok;
+}
+
+#define RENDER_RATE (44100)
+#define RENDER_FRAMES (1024)
+#define RENDER_TAIL (2)         //seconds rendered after the last event, for the sound to die away
+#define RENDER_CHUNK (16384)    //frames each synth of a pool renders at a time for mixing
+#define RENDER_CHUNKS (4)       //chunks each synth of a pool may render ahead of the mixing
+#define RENDER_SYNTHS (3)       //most synths to run at once, each loads the whole soundfont
+
+typedef struct RenderEvent
+{
+  gdouble time;
+  guint order;                  //keeps events at the same time in the order they were in the MIDI
+  gsize length;
+  guchar *data;
+} RenderEvent;
+
+typedef struct AudioRender
+{
+  GArray *events;               //the RenderEvents to play, in time order
+  gchar *filename;
+  gpointer synth;
+  gboolean ok;
+  guint next;                   //the next event to play
+  gint64 done;                  //frames rendered so far
+  gint64 total;                 //frames to render
+  guint channels;               //bit mask of the MIDI channels of the events, for a synth of a pool
+  GAsyncQueue *free_chunks;     //chunks of interleaved stereo for a synth of a pool to render into
+  GAsyncQueue *full_chunks;     //chunks it has rendered, in order
+} AudioRender;
+
+static gint
+render_event_compare (const RenderEvent * a, const RenderEvent * b)
+{
+  if (a->time != b->time)
+    return (a->time < b->time) ? -1 : 1;
+  return (gint) a->order - (gint) b->order;
+}
+
+static void
+free_audio_render (AudioRender * render)
+{
+  guint i;
+  for (i = 0; i < render->events->len; i++)
+    g_free (g_array_index (render->events, RenderEvent, i).data);
+  g_array_free (render->events, TRUE);
+  g_free (render->filename);
+  if (render->free_chunks)
+    g_async_queue_unref (render->free_chunks);
+  if (render->full_chunks)
+    g_async_queue_unref (render->full_chunks);
+  g_free (render);
+}
+
+static AudioRender *
+new_audio_render (gchar * filename)
+{
+  AudioRender *render = (AudioRender *) g_malloc0 (sizeof (AudioRender));
+  render->events = g_array_new (FALSE, FALSE, sizeof (RenderEvent));
+  render->filename = filename;
+  return render;
+}
+
+/* copy the events of track into render, so that the rendering does not depend on the MIDI of the movement, which may be regenerated meanwhile */
+static void
+add_track_events (AudioRender * render, smf_track_t * track)
+{
+  gint i;
+  for (i = 1; i <= track->number_of_events; i++)
+    {
+      smf_event_t *event = smf_track_get_event_by_number (track, i);
+      RenderEvent copy;
+      if (smf_event_is_metadata (event) || (event->midi_buffer_length == 0))
+        continue;
+      copy.time = event->time_seconds;
+      copy.order = render->events->len;
+      copy.length = event->midi_buffer_length;
+      copy.data = g_malloc (event->midi_buffer_length);
+      memcpy (copy.data, event->midi_buffer, event->midi_buffer_length);
+      g_array_append_val (render->events, copy);
+    }
+}
+
+/* the MIDI channel of the first channel message of track, or -1 if it has none */
+static gint
+track_channel (smf_track_t * track)
+{
+  gint i;
+  for (i = 1; i <= track->number_of_events; i++)
+    {
+      smf_event_t *event = smf_track_get_event_by_number (track, i);
+      if ((event->midi_buffer_length > 0) && (event->midi_buffer[0] >= 0x80) && (event->midi_buffer[0] < 0xF0))
+        return event->midi_buffer[0] & 0x0F;
+    }
+  return -1;
+}
+
+/* the name given to the staff whose MIDI is track, or NULL */
+static gchar *
+track_name (smf_track_t * track)
+{
+  gint i;
+  for (i = 1; i <= track->number_of_events; i++)
+    {
+      smf_event_t *event = smf_track_get_event_by_number (track, i);
+      if (smf_event_is_metadata (event) && (event->midi_buffer_length > 1) && (event->midi_buffer[1] == 0x03))
+        {
+          char *text = smf_event_extract_text (event);
+          gchar *name = text ? g_strcanon (g_strdup (text), G_CSET_A_2_Z G_CSET_a_2_z G_CSET_DIGITS "-_", '_') : NULL;
+          free (text);
+          return name;
+        }
+    }
+  return NULL;
+}
+
+static gint
+audio_format (const gchar * filename)
+{
+  gchar *name = g_ascii_strdown (filename, -1);
+  gint format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+  if (g_str_has_suffix (name, ".ogg"))
+    format = SF_FORMAT_OGG | SF_FORMAT_VORBIS;
+  else if (g_str_has_suffix (name, ".flac"))
+    format = SF_FORMAT_FLAC | SF_FORMAT_PCM_16;
+  g_free (name);
+  return format;
+}
+
+/* the number of frames needed for all the events of render and the sound to die away */
+static gint64
+render_length (AudioRender * render)
+{
+  gint64 last = 0;
+  if (render->events->len)
+    last = (gint64) (g_array_index (render->events, RenderEvent, render->events->len - 1).time * RENDER_RATE);
+  return last + RENDER_TAIL * RENDER_RATE;
+}
+
+/* render the next n frames of render into out as interleaved stereo, feeding its synth the events as they fall due */
+static void
+render_frames (AudioRender * render, float *out, gint n)
+{
+  float left[RENDER_FRAMES], right[RENDER_FRAMES];
+  while (n > 0)
+    {
+      gint m = MIN (n, RENDER_FRAMES), j;
+      while (render->next < render->events->len)
+        {
+          RenderEvent *event = &g_array_index (render->events, RenderEvent, render->next);
+          gint64 at = (gint64) (event->time * RENDER_RATE);
+          if (at > render->done)
+            {
+              m = (gint) MIN (m, at - render->done);
+              break;
+            }
+          fluidsynth_offline_feed_midi (render->synth, event->data, event->length);
+          render->next++;
+        }
+      fluidsynth_offline_render (render->synth, m, left, right);
+      for (j = 0; j < m; j++)
+        {
+          out[2 * j] = left[j];
+          out[2 * j + 1] = right[j];
+        }
+      out += 2 * m;
+      n -= m;
+      render->done += m;
+    }
+}
+
+/* play the events of render into its synth, writing the audio to its file as fast as it can be computed */
+static gpointer
+render_to_file (AudioRender * render)
+{
+  SF_INFO info;
+  SNDFILE *out;
+  float frames[2 * RENDER_FRAMES];
+  memset (&info, 0, sizeof (info));
+  info.format = audio_format (render->filename);
+  info.channels = 2;
+  info.samplerate = RENDER_RATE;
+  out = sf_open (render->filename, SFM_WRITE, &info);
+  if (out == NULL)
+    {
+      g_warning ("Unable to open file %s for writing this format", render->filename);
+      return NULL;
+    }
+  render->total = render_length (render);
+  while (render->done < render->total)
+    {
+      gint n = (gint) MIN (RENDER_FRAMES, render->total - render->done);
+      render_frames (render, frames, n);
+      if (sf_writef_float (out, frames, n) != n)
+        {
+          sf_close (out);
+          return NULL;
+        }
+    }
+  render->ok = (sf_close (out) == 0);
+  return NULL;
+}
+
+/* render the audio of render, a synth of a pool, chunk by chunk for mixing with the others */
+static gpointer
+render_chunks (AudioRender * render)
+{
+  while (render->done < render->total)
+    {
+      float *chunk = (float *) g_async_queue_pop (render->free_chunks);
+      render_frames (render, chunk, (gint) MIN (RENDER_CHUNK, render->total - render->done));
+      g_async_queue_push (render->full_chunks, chunk);
+    }
+  return NULL;
+}
+
+/* add n interleaved stereo frames of in to mix */
+static void
+mix_chunk (float *mix, const float *in, gint n)
+{
+  gint j;
+  for (j = 0; j < 2 * n; j++)
+    mix[j] += in[j];
+}
+
+/* render the AudioRenders of pool, each with a synth of its own on a thread of its own, mixing them into the file outname */
+static gboolean
+render_pool (GPtrArray * pool, const gchar * outname, const gint * programs)
+{
+  SF_INFO info;
+  SNDFILE *out;
+  GThread **threads = g_new0 (GThread *, pool->len);
+  float *mix = g_new (float, 2 * RENDER_CHUNK);
+  float *chunk = g_new (float, 2 * RENDER_CHUNK);
+  gint64 total = 0, done;
+  gboolean ok = TRUE;
+  guint i, k;
+  for (i = 0; i < pool->len; i++)
+    {
+      AudioRender *render = (AudioRender *) g_ptr_array_index (pool, i);
+      render->synth = fluidsynth_new_offline (RENDER_RATE, programs);
+      ok = ok && (render->synth != NULL);
+      total = MAX (total, render_length (render));
+    }
+  memset (&info, 0, sizeof (info));
+  info.format = audio_format (outname);
+  info.channels = 2;
+  info.samplerate = RENDER_RATE;
+  out = ok ? sf_open (outname, SFM_WRITE, &info) : NULL;
+  if (out == NULL)
+    {
+      if (ok)
+        g_warning ("Unable to open file %s for writing this format", outname);
+      ok = FALSE;
+    }
+  else
+    {
+      for (i = 0; i < pool->len; i++)
+        {
+          AudioRender *render = (AudioRender *) g_ptr_array_index (pool, i);
+          render->total = total;
+          if (pool->len == 1)
+            continue;           //no need for a thread
+          render->free_chunks = g_async_queue_new_full (g_free);
+          render->full_chunks = g_async_queue_new_full (g_free);
+          for (k = 0; k < RENDER_CHUNKS; k++)
+            g_async_queue_push (render->free_chunks, g_new (float, 2 * RENDER_CHUNK));
+          threads[i] = g_thread_try_new ("Audio render", (GThreadFunc) render_chunks, render, NULL);
+        }
+      for (done = 0; done < total; done += RENDER_CHUNK)
+        {
+          gint n = (gint) MIN (RENDER_CHUNK, total - done);
+          memset (mix, 0, 2 * n * sizeof (float));
+          for (i = 0; i < pool->len; i++)
             {
-              gint len = strlen (outfile);
-              if (len > 4)
+              AudioRender *render = (AudioRender *) g_ptr_array_index (pool, i);
+              if (threads[i])
                 {
-                  if (*(outfile + len - 3) == 'o')
-                    {
-                      out.format = SF_FORMAT_VORBIS | SF_FORMAT_OGG;
-                    }
-                  else
-                    {
-                      out.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
-                    }
-                  out.channels = 2;
-                  out.samplerate = 44100;
-                  gpointer outsnd = sf_open (outfile, SFM_WRITE, &out);
-                  if (outsnd)
-                    {
-					  gsize i;
-					  gboolean silence = TRUE;
-					  
-					  progressbar (_("Saving audio .. please wait"), NULL);
-					  for (i=0;i<length/sizeof(float);i++)
-						{
-							float out[2];
-							out[0] = out [1] = *(data+i);
-							if (silence && (fabs(*out) < 0.0001))
-								continue;
-							else
-								silence = FALSE;
-							sf_writef_float (outsnd, out, 1);
-							if (!(i%44100))
-								keep_alive ();
-						}
-                      g_free(data);
-                      sf_close (outsnd);
-                      progressbar_stop ();
-                      return TRUE;
-                    }
-                  else
-                    {
-                      g_warning ("Unable to open file %s for writing this format", outfile);
-                    }
-                  g_free (outfile);
+                  float *rendered = (float *) g_async_queue_pop (render->full_chunks);
+                  mix_chunk (mix, rendered, n);
+                  g_async_queue_push (render->free_chunks, rendered);
+                }
+              else
+                {
+                  render_frames (render, chunk, n);
+                  mix_chunk (mix, chunk, n);
                 }
             }
+          //once writing has failed the synths are still run to the end, so that their threads finish
+          if (ok && (sf_writef_float (out, mix, n) != n))
+            ok = FALSE;
         }
-        else
+      for (i = 0; i < pool->len; i++)
+        if (threads[i])
+          g_thread_join (threads[i]);
+      if (sf_close (out))
+        ok = FALSE;
+    }
+  for (i = 0; i < pool->len; i++)
+    {
+      AudioRender *render = (AudioRender *) g_ptr_array_index (pool, i);
+      if (render->synth)
+        fluidsynth_free_offline (render->synth);
+      render->synth = NULL;
+    }
+  g_free (threads);
+  g_free (mix);
+  g_free (chunk);
+  return ok;
+}
+
+/* the number of synths to run at once, one per processor up to RENDER_SYNTHS */
+static guint
+render_synths (void)
+{
+  guint synths = 1;
+#if GLIB_CHECK_VERSION(2,36,0)
+  synths = g_get_num_processors ();
+#endif
+  return MAX (1, MIN (synths, RENDER_SYNTHS));
+}
+
+/* render the AudioRenders in renders, as many at once as render_synths (), each with a synth of its own */
+static gboolean
+render_all (GPtrArray * renders, const gint * programs)
+{
+  gint window = render_synths (), n, k;
+  guint i = 0;
+  gboolean ok = TRUE;
+  GThread **threads;
+  threads = g_new0 (GThread *, window);
+  while (i < renders->len)
+    {
+      for (n = 0; (i < renders->len) && (n < window); n++, i++)
         {
-          if (Denemo.prefs.maxrecordingtime)
-            warningdialog (_("No audio recording has been made.\nSee Playback Controls - Record Button"));
-          else
-            warningdialog (_("The preference set for recording time is 0 - nothing is recorded.\nSee Edit → Change Preferences Audio/Midi Tab"));
+          AudioRender *render = (AudioRender *) g_ptr_array_index (renders, i);
+          render->synth = fluidsynth_new_offline (RENDER_RATE, programs);
+          threads[n] = NULL;
+          if (render->synth && (window > 1))
+            threads[n] = g_thread_try_new ("Audio render", (GThreadFunc) render_to_file, render, NULL);
+          if (render->synth && (threads[n] == NULL))
+            render_to_file (render);
+        }
+      for (k = 0; k < n; k++)
+        {
+          AudioRender *render = (AudioRender *) g_ptr_array_index (renders, i - n + k);
+          if (threads[k])
+            g_thread_join (threads[k]);
+          if (render->synth)
+            fluidsynth_free_offline (render->synth);
+          render->synth = NULL;
+          ok = ok && render->ok;
         }
     }
-  return FALSE;
+  g_free (threads);
+  return ok;
+}
+
+typedef struct RenderJob
+{
+  GPtrArray *renders;
+  gchar *outfile;
+  gboolean stems;
+  gint programs[16];            //the program of each MIDI channel, taken from the staffs before rendering starts
+  gboolean ok;
+  gint finished;
+} RenderJob;
+
+static gboolean rendering = FALSE;      //a render is running, the main loop being kept alive meanwhile
+
+/* render the AudioRenders of job, off the GTK thread, without looking at the score */
+static gpointer
+render_audio_thread (RenderJob * job)
+{
+  job->ok = job->stems ? render_all (job->renders, job->programs) : render_pool (job->renders, job->outfile, job->programs);
+  g_atomic_int_set (&job->finished, TRUE);
+  return NULL;
 }
 
+/**
+ * Render the MIDI of the current movement as audio into outname (.wav, .ogg or .flac), or a file chosen by the user if NULL.
+ * The synth is driven directly from the MIDI, so this takes only as long as the computation rather than the duration of the music.
+ * If stems is TRUE each MIDI track (i.e. each staff) is written to a file of its own, named from outname and the staff,
+ * several being rendered at once. Otherwise the tracks are shared among a pool of synths running at once, which are mixed.
+ * Returns TRUE if all the audio was written.
+ */
+gboolean
+render_audio (const gchar * outname, gboolean stems)
+{
+  smf_t *smf;
+  gchar *outfile;
+  GPtrArray *renders;
+  RenderJob job;
+  GThread *thread = NULL;
+  GList *staffs;
+  gint i;
+  if (rendering)
+    {
+      g_warning ("An audio render is already running");
+      return FALSE;
+    }
+  generate_midi ();
+  smf = Denemo.project->movement->smf;
+  if (smf == NULL)
+    return FALSE;
+  if (outname == NULL)
+    {
+      GList *exts = g_list_append (NULL, "*.wav");
+      exts = g_list_append (exts, "*.ogg");
+      exts = g_list_append (exts, "*.flac");
+      outfile = file_dialog ("Give output audio file name, with .wav, .ogg or .flac extension", FALSE, Denemo.prefs.denemopath->str, NULL, exts);
+      g_list_free (exts);
+      if (outfile == NULL)
+        return FALSE;
+    }
+  else
+    outfile = g_strdup (outname);
+
+  renders = g_ptr_array_new_with_free_func ((GDestroyNotify) free_audio_render);
+  if (stems)
+    {
+      gchar *ext = strrchr (outfile, '.');
+      gchar *base = (ext && !strchr (ext, G_DIR_SEPARATOR)) ? g_strndup (outfile, ext - outfile) : g_strdup (outfile);
+      if (ext == NULL || strchr (ext, G_DIR_SEPARATOR))
+        ext = ".wav";
+      for (i = 1; i <= smf->number_of_tracks; i++)
+        {
+          smf_track_t *track = smf_get_track_by_number (smf, i);
+          gchar *name = track_name (track);
+          AudioRender *render = new_audio_render (name ? g_strdup_printf ("%s-%d-%s%s", base, i, name, ext) : g_strdup_printf ("%s-track%d%s", base, i, ext));
+          g_free (name);
+          add_track_events (render, track);
+          if (render->events->len)
+            g_ptr_array_add (renders, render);
+          else
+            free_audio_render (render);
+        }
+      g_free (base);
+    }
+  else
+    {
+      /* share the tracks among a pool of synths, as many as render_synths (), never putting two tracks on the same channel
+       * of one synth so that there can be more than 16 instruments, and the least loaded synth taking each track */
+      guint groups = render_synths (), g;
+      groups = MIN (groups, (guint) MAX (1, smf->number_of_tracks));
+      for (g = 0; g < groups; g++)
+        g_ptr_array_add (renders, new_audio_render (NULL));
+      for (i = 1; i <= smf->number_of_tracks; i++)
+        {
+          smf_track_t *track = smf_get_track_by_number (smf, i);
+          gint channel = track_channel (track);
+          guint mask = (channel < 0) ? 0 : (1u << channel);
+          AudioRender *least = NULL;
+          for (g = 0; g < renders->len; g++)
+            {
+              AudioRender *render = (AudioRender *) g_ptr_array_index (renders, g);
+              if (!(render->channels & mask) && ((least == NULL) || (render->events->len < least->events->len)))
+                least = render;
+            }
+          if (least == NULL)
+            {
+              least = new_audio_render (NULL);
+              g_ptr_array_add (renders, least);
+            }
+          least->channels |= mask;
+          add_track_events (least, track);
+        }
+      for (g = renders->len; g > 0; g--)
+        {
+          AudioRender *render = (AudioRender *) g_ptr_array_index (renders, g - 1);
+          if (render->events->len)
+            g_array_sort (render->events, (GCompareFunc) render_event_compare);
+          else if (renders->len > 1)
+            g_ptr_array_remove_index (renders, g - 1);
+        }
+    }
+  memset (&job, 0, sizeof (job));
+  job.renders = renders;
+  job.outfile = outfile;
+  job.stems = stems;
+  for (staffs = Denemo.project->movement->thescore; staffs; staffs = staffs->next)
+    {
+      DenemoStaff *staff = (DenemoStaff *) staffs->data;
+      if ((staff->midi_channel >= 0) && (staff->midi_channel < 16))
+        job.programs[staff->midi_channel] = staff->midi_prognum;
+    }
+  if (!Denemo.non_interactive)
+    thread = g_thread_try_new ("Audio render", (GThreadFunc) render_audio_thread, &job, NULL);
+  if (thread == NULL)
+    render_audio_thread (&job);
+  else
+    {
+      rendering = TRUE;
+      progressbar (_("Rendering audio .. please wait"), NULL);
+      while (!g_atomic_int_get (&job.finished))
+        {
+          keep_alive ();
+          g_usleep (50000);
+        }
+      g_thread_join (thread);
+      progressbar_stop ();
+      rendering = FALSE;
+    }
+  if (!job.ok)
+    g_warning ("Rendering audio to %s failed", outfile);
+  g_ptr_array_free (renders, TRUE);
+  g_free (outfile);
+  return job.ok;
+}
@@ -23,6 +23,10 @@
 #include <denemo/denemo.h>
 const gchar *
 recorded_audio_filename(void);
+void
+set_recorded_audio_samplerate (gint rate);
 gboolean
 export_recorded_audio (const gchar *name);
+gboolean
+render_audio (const gchar *outname, gboolean stems);
 #endif
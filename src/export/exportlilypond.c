@@ -60,6 +60,7 @@
 #define INEDITABLE "ineditable"
 #define HIGHLIGHT "highlight"
 #define ERRORTEXT "error text"
+#define SECTION_MOVEMENT "section movement"
 
 gchar *get_postfix (GList * g); //HIDDEN INSIDE GET_AFFIX macro
 gchar *get_prefix (GList * g); //HIDDEN INSIDE GET_AFFIX macro
@@ -67,6 +68,14 @@ gchar *get_prefix (GList * g); //HIDDEN INSIDE GET_AFFIX macro
 static void output_score_to_buffer (DenemoProject * gui, gboolean all_movements, gchar * partname, gchar * instrumentation);
 static GtkTextTagTable *tagtable;
 
+/* State for regenerating only the voices whose LilyPond text has changed, see output_score_to_buffer() */
+static guint64 layout_fingerprint;      /* fingerprint of the score structure and the text other than the music of the voices */
+static GArray *voice_fingerprints;      /* fingerprint of the music of each voice, in the order output, 0 for voices not output */
+static gboolean fingerprints_valid;     /* the textbuffer holds the text that the fingerprints describe */
+static GHashTable *music_sections;      /* name of a music section -> GtkTextChildAnchor at the start of the section */
+static gboolean regenerating_voice;     /* TRUE while outputStaff() is replacing the text of a voice already in the textbuffer */
+static gint section_movement;   /* movement number (from 1) whose music sections are being inserted, 0 if not known */
+
 /* inserts a navigation anchor into the lilypond textbuffer at curmark */
 static void
 place_navigation_anchor (GtkTextMark * curmark, gpointer curobjnode, gint movement_count, gint measurenum, gint voice_count, gint objnum, DenemoTargetType type, gint mid_c_offset)
@@ -1733,14 +1742,123 @@ generate_lily_for_obj (DenemoProject * gui, GtkTextIter * iter, DenemoObject * c
 }
 
 /* create and insertion point and button for the next piece of music */
+/* removes the text of the named music section, leaving its mark at the start of the now empty section.
+   Any anchors for editable text in the section are dropped from gui->anchors */
+static void
+clear_music_section (DenemoProject * gui, gchar * name)
+{
+  GtkTextChildAnchor *anchor = music_sections ? g_hash_table_lookup (music_sections, name) : NULL;
+  GtkTextMark *mark = gtk_text_buffer_get_mark (Denemo.textbuffer, name);
+  GtkTextIter start, end;
+  GList *g, *next;
+  if ((anchor == NULL) || (mark == NULL) || gtk_text_child_anchor_get_deleted (anchor))
+    {
+      g_warning ("Music section %s not found", name);
+      return;
+    }
+  gtk_text_buffer_get_iter_at_child_anchor (Denemo.textbuffer, &start, anchor);
+  (void) gtk_text_iter_forward_char (&start);
+  gtk_text_buffer_get_iter_at_mark (Denemo.textbuffer, &end, mark);
+  for (g = gui->anchors; g; g = next)
+    {
+      GtkTextIter iter;
+      next = g->next;
+      gtk_text_buffer_get_iter_at_child_anchor (Denemo.textbuffer, &iter, (GtkTextChildAnchor *) g->data);
+      if (gtk_text_iter_in_range (&iter, &start, &end))
+        {
+          g_free (g_object_get_data (G_OBJECT (g->data), ORIGINAL));
+          g_object_set_data (G_OBJECT (g->data), ORIGINAL, NULL);
+          gui->anchors = g_list_delete_link (gui->anchors, g);
+        }
+    }
+  gtk_text_buffer_delete (Denemo.textbuffer, &start, &end);
+}
+
 static void
 insert_music_section (DenemoProject * gui, gchar * name)
 {
   GtkTextIter iter;
+  if (regenerating_voice)
+    {
+      clear_music_section (gui, name);
+      return;
+    }
   gtk_text_buffer_get_iter_at_mark (Denemo.textbuffer, &iter, gtk_text_buffer_get_mark (Denemo.textbuffer, MUSIC));
   gtk_text_buffer_insert (Denemo.textbuffer, &iter, "\n", -1);
   (void) gtk_text_iter_backward_char (&iter);
-  insert_section (NULL, name, name, &iter, gui);
+  if (music_sections == NULL)
+    music_sections = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  GtkTextChildAnchor *anchor = insert_section (NULL, name, name, &iter, gui);
+  g_object_set_data (G_OBJECT (anchor), SECTION_MOVEMENT, GINT_TO_POINTER (section_movement));
+  g_hash_table_insert (music_sections, g_strdup (name), anchor);
+}
+
+static gint
+compare_section_ranges (const gint * a, const gint * b)
+{
+  return a[1] - b[1];
+}
+
+/* Appends to ranges (a GArray of gint) a triple movement number, start, end for each music section of the LilyPond text
+ * last generated, in the order they occur in the text. start and end are byte offsets into the text as exported,
+ * that is the visible text of the textbuffer, end being the offset just after the music of the section.
+ * Returns FALSE if the sections are not known
+ */
+gboolean
+get_music_section_ranges (GArray * ranges)
+{
+  GHashTableIter hiter;
+  gpointer key, value;
+  GArray *sections;             //triples movement, start, end as character offsets in the textbuffer
+  GtkTextIter previous;
+  gint bytes = 0;               //the length of the visible text up to previous
+  guint i, j;
+  if ((music_sections == NULL) || (Denemo.textbuffer == NULL) || (g_hash_table_size (music_sections) == 0))
+    return FALSE;
+  sections = g_array_new (FALSE, FALSE, sizeof (gint));
+  g_hash_table_iter_init (&hiter, music_sections);
+  while (g_hash_table_iter_next (&hiter, &key, &value))
+    {
+      GtkTextChildAnchor *anchor = (GtkTextChildAnchor *) value;
+      GtkTextMark *mark = gtk_text_buffer_get_mark (Denemo.textbuffer, (gchar *) key);
+      gint movement = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (anchor), SECTION_MOVEMENT));
+      GtkTextIter start, end;
+      if ((movement == 0) || (mark == NULL) || gtk_text_child_anchor_get_deleted (anchor))
+        {
+          g_array_free (sections, TRUE);
+          return FALSE;
+        }
+      gtk_text_buffer_get_iter_at_child_anchor (Denemo.textbuffer, &start, anchor);
+      gtk_text_buffer_get_iter_at_mark (Denemo.textbuffer, &end, mark);     //the music is inserted before the mark
+      gint triple[3] = { movement, gtk_text_iter_get_offset (&start), gtk_text_iter_get_offset (&end) };
+      g_array_append_vals (sections, triple, 3);
+    }
+  //the hash table is in no particular order, the offsets are converted working through the text from the start
+  g_qsort_with_data (sections->data, sections->len / 3, 3 * sizeof (gint), (GCompareDataFunc) compare_section_ranges, NULL);
+  gtk_text_buffer_get_start_iter (Denemo.textbuffer, &previous);
+  for (i = 0; i < sections->len; i += 3)
+    {
+      gint triple[3] = { g_array_index (sections, gint, i) };
+      for (j = 1; j < 3; j++)
+        {
+          GtkTextIter iter;
+          gchar *text;
+          gtk_text_buffer_get_iter_at_offset (Denemo.textbuffer, &iter, g_array_index (sections, gint, i + j));
+          if (gtk_text_iter_compare (&iter, &previous) < 0)
+            {                   //overlapping sections
+              g_array_free (sections, TRUE);
+              return FALSE;
+            }
+          text = gtk_text_buffer_get_text (Denemo.textbuffer, &previous, &iter, FALSE);
+          bytes += strlen (text);
+          g_free (text);
+          triple[j] = bytes;
+          previous = iter;
+        }
+      g_array_append_vals (ranges, triple, 3);
+    }
+  g_array_free (sections, TRUE);
+  return TRUE;
 }
 
 /* create and insertion point and button for the next scoreblock */
@@ -2418,6 +2536,7 @@ void
 force_lily_refresh (DenemoProject * gui)
 {
   gui->lilysync = G_MAXUINT;
+  fingerprints_valid = FALSE;
   refresh_lily_cb (NULL, gui);
 }
 
@@ -2742,12 +2861,230 @@ generate_lilypond_part (void)
   output_score_to_buffer (Denemo.project, TRUE, staff->lily_name->str, staff->denemo_name->str);
 }
 
+#define FINGERPRINT_SEED G_GUINT64_CONSTANT (14695981039346656037)
+#define FINGERPRINT_PRIME G_GUINT64_CONSTANT (1099511628211)
+#define fingerprint_value(h, v) fingerprint_bytes ((h), &(v), sizeof (v))
+#define fingerprint_gstring(h, s) fingerprint_string ((h), (s) ? ((GString *) (s))->str : NULL)
+
+/* FNV-1a hash of the bytes at data folded into h */
+static guint64
+fingerprint_bytes (guint64 h, gconstpointer data, gsize len)
+{
+  const guchar *p = data;
+  while (len--)
+    h = (h ^ *p++) * FINGERPRINT_PRIME;
+  return h;
+}
+
+static guint64
+fingerprint_string (guint64 h, const gchar * str)
+{
+  if (str == NULL)
+    return fingerprint_bytes (h, "\1", 1);     //distinguish NULL from ""
+  return fingerprint_bytes (h, str, strlen (str) + 1);
+}
+
+static guint64
+fingerprint_directives (guint64 h, GList * directives)
+{
+  for (; directives; directives = directives->next)
+    {
+      DenemoDirective *directive = directives->data;
+      GList *g;
+      h = fingerprint_gstring (h, directive->tag);
+      h = fingerprint_gstring (h, directive->prefix);
+      h = fingerprint_gstring (h, directive->postfix);
+      h = fingerprint_gstring (h, directive->display);
+      h = fingerprint_gstring (h, directive->grob);
+      h = fingerprint_value (h, directive->override);
+      h = fingerprint_value (h, directive->flag);
+      for (g = directive->layouts; g; g = g->next)
+        h = fingerprint_value (h, g->data);
+    }
+  return fingerprint_bytes (h, "", 1);  //end of list
+}
+
+/* fingerprint of the properties of an object that its LilyPond text is generated from */
+static guint64
+fingerprint_object (guint64 h, DenemoObject * obj)
+{
+  GList *g;
+  h = fingerprint_value (h, obj->type);
+  h = fingerprint_value (h, obj->basic_durinticks);
+  h = fingerprint_value (h, obj->durinticks);
+  h = fingerprint_value (h, obj->isinvisible);
+  h = fingerprint_directives (h, obj->directives);
+  switch (obj->type)
+    {
+    case CHORD:
+      {
+        chord *pchord = (chord *) obj->object;
+        gboolean flags[] = { pchord->chordize, pchord->is_tied, pchord->slur_begin_p, pchord->slur_end_p,
+          pchord->crescendo_begin_p, pchord->crescendo_end_p, pchord->diminuendo_begin_p, pchord->diminuendo_end_p,
+          pchord->is_grace, pchord->struck_through, pchord->has_dynamic, pchord->is_syllable, pchord->center_lyric
+        };
+        h = fingerprint_value (h, pchord->baseduration);
+        h = fingerprint_value (h, pchord->numdots);
+        h = fingerprint_value (h, flags);
+        for (g = pchord->notes; g; g = g->next)
+          {
+            note *thenote = (note *) g->data;
+            h = fingerprint_value (h, thenote->mid_c_offset);
+            h = fingerprint_value (h, thenote->enshift);
+            h = fingerprint_value (h, thenote->showaccidental);
+            h = fingerprint_value (h, thenote->noteheadtype);
+            h = fingerprint_directives (h, thenote->directives);
+          }
+        for (g = pchord->dynamics; g; g = g->next)
+          h = fingerprint_gstring (h, g->data);
+        h = fingerprint_gstring (h, pchord->lyric);
+        h = fingerprint_gstring (h, pchord->figure);
+        h = fingerprint_gstring (h, pchord->fakechord);
+        h = fingerprint_directives (h, pchord->directives);
+      }
+      break;
+    case TUPOPEN:
+    case TUPCLOSE:
+      h = fingerprint_value (h, ((tupopen *) obj->object)->numerator);
+      h = fingerprint_value (h, ((tupopen *) obj->object)->denominator);
+      h = fingerprint_directives (h, ((tupopen *) obj->object)->directives);
+      break;
+    case CLEF:
+      h = fingerprint_value (h, ((clef *) obj->object)->type);
+      h = fingerprint_directives (h, ((clef *) obj->object)->directives);
+      break;
+    case TIMESIG:
+      h = fingerprint_value (h, ((timesig *) obj->object)->time1);
+      h = fingerprint_value (h, ((timesig *) obj->object)->time2);
+      h = fingerprint_directives (h, ((timesig *) obj->object)->directives);
+      break;
+    case KEYSIG:
+      h = fingerprint_value (h, ((keysig *) obj->object)->number);
+      h = fingerprint_value (h, ((keysig *) obj->object)->isminor);
+      h = fingerprint_value (h, ((keysig *) obj->object)->mode);
+      h = fingerprint_directives (h, ((keysig *) obj->object)->directives);
+      break;
+    case STEMDIRECTIVE:
+      h = fingerprint_value (h, ((stemdirective *) obj->object)->type);
+      h = fingerprint_directives (h, ((stemdirective *) obj->object)->directives);
+      break;
+    case LILYDIRECTIVE:
+      {
+        GList single = { obj->object, NULL, NULL };
+        h = fingerprint_directives (h, &single);
+      }
+      break;
+    default:
+      break;
+    }
+  return h;
+}
+
+/* fingerprint of the inclusion criteria that wrong_layout () tests directives against */
+static guint64
+fingerprint_criteria (guint64 h)
+{
+  GList *g;
+  guint32 current = Denemo.project->criterion ? Denemo.project->criterion->id : 0;
+  for (g = Denemo.project->criteria; g; g = g->next)
+    h = fingerprint_value (h, ((DenemoInclusionCriterion *) g->data)->id);
+  return fingerprint_value (h, current);
+}
+
+/* fingerprint of everything outputStaff() generates the text of the voice from, including the staff and voice
+ * properties it reads even where they are only output elsewhere, so that a voice is never wrongly taken as unchanged */
+static guint64
+fingerprint_voice (DenemoStaff * staff, gint movement_count, gint voice_count, DenemoScoreblock * sb)
+{
+  guint64 h = FINGERPRINT_SEED;
+  GList *g, *h2;
+  h = fingerprint_value (h, movement_count);
+  h = fingerprint_value (h, voice_count);
+  h = fingerprint_value (h, sb->id);
+  h = fingerprint_criteria (h);
+  h = fingerprint_string (h, staff->type);
+  h = fingerprint_gstring (h, staff->denemo_name);
+  h = fingerprint_gstring (h, staff->subpart);
+  h = fingerprint_gstring (h, staff->lily_name);
+  h = fingerprint_value (h, staff->transposition);
+  h = fingerprint_value (h, staff->context);
+  h = fingerprint_value (h, staff->voicecontrol);
+  h = fingerprint_value (h, staff->hide_lyrics);
+  h = fingerprint_value (h, staff->hasfigures);
+  h = fingerprint_value (h, staff->hasfakechords);
+  h = fingerprint_directives (h, staff->staff_directives);
+  h = fingerprint_directives (h, staff->voice_directives);
+  h = fingerprint_value (h, staff->timesig.time1);
+  h = fingerprint_value (h, staff->timesig.time2);
+  h = fingerprint_directives (h, staff->timesig.directives);
+  h = fingerprint_value (h, staff->keysig.number);
+  h = fingerprint_value (h, staff->keysig.isminor);
+  h = fingerprint_value (h, staff->keysig.mode);
+  h = fingerprint_directives (h, staff->keysig.directives);
+  h = fingerprint_value (h, staff->clef.type);
+  h = fingerprint_directives (h, staff->clef.directives);
+  if (!staff->hide_lyrics)
+    for (g = staff->verse_views; g; g = g->next)
+      {
+        gchar *text = get_text_from_view (g->data);
+        h = fingerprint_string (h, text);
+        g_free (text);
+      }
+  for (g = staff->themeasures; g; g = g->next)
+    {
+      h = fingerprint_bytes (h, "|", 1);
+      for (h2 = ((DenemoMeasure *) g->data)->objects; h2; h2 = h2->next)
+        h = fingerprint_object (h, (DenemoObject *) h2->data);
+    }
+  return h ? h : 1;             //0 is reserved for voices not output
+}
+
+/* fingerprint of the structure of the score and the parts of the LilyPond text other than the music of the voices */
+static guint64
+fingerprint_layout (DenemoProject * gui, DenemoScoreblock * sb, gboolean all_movements)
+{
+  guint64 h = FINGERPRINT_SEED;
+  gboolean continuous = continuous_typesetting ();
+  GString *header = g_string_new ("");
+  GList *g, *h2;
+  h = fingerprint_value (h, gui);
+  h = fingerprint_value (h, sb);
+  h = fingerprint_value (h, sb->id);
+  h = fingerprint_value (h, sb->text_only);
+  h = fingerprint_gstring (h, sb->lilypond);
+  h = fingerprint_value (h, all_movements);
+  h = fingerprint_value (h, continuous);
+  outputHeader (header, gui);
+  h = fingerprint_gstring (h, header);
+  g_string_free (header, TRUE);
+  h = fingerprint_directives (h, gui->lilycontrol.directives);
+  for (g = gui->movements; g; g = g->next)
+    {
+      gboolean visible = all_movements || (g->data == gui->movement);
+      h = fingerprint_value (h, g->data);
+      h = fingerprint_value (h, visible);
+      for (h2 = ((DenemoMovement *) g->data)->thescore; h2; h2 = h2->next)
+        {
+          DenemoStaff *staff = (DenemoStaff *) h2->data;
+          gint verses = g_list_length (staff->verse_views);
+          h = fingerprint_value (h, h2->data);
+          h = fingerprint_value (h, staff->voicecontrol);
+          h = fingerprint_value (h, staff->hide_lyrics);
+          h = fingerprint_value (h, verses);
+          h = fingerprint_value (h, staff->hasfigures);
+          h = fingerprint_value (h, staff->hasfakechords);
+        }
+    }
+  return h;
+}
+
 /*
  *writes the current score in LilyPond format to the textbuffer.
  *sets gui->lilysync equal to gui->changecount
  *if gui->lilysync is up to date with changecount on entry does nothing unless
  *the set of score blocks will be different from the last call
  * this namespec is not otherwise used FIXME
+ *if only the music of some voices has changed since the last call just the text of those voices is regenerated
  */
 
 
@@ -2795,93 +3132,113 @@ output_score_to_buffer (DenemoProject * gui, gboolean all_movements, gchar * par
   gui->namespec = namespec;
   //g_debug("actually refreshing %d %d", gui->lilysync, gui->changecount);
   gui->lilysync = gui->changecount;
-  if (Denemo.textbuffer && (continuous_typesetting () || !g_object_get_data (G_OBJECT(Denemo.textbuffer), "append")))
-    gtk_text_buffer_set_text (Denemo.textbuffer, "", -1);
-  if (!Denemo.textbuffer)
-    warningdialog (_("No textbuffer"));
-  if (gui->anchors)
+
+  /* if the structure and the text outside the music of the voices are unchanged only the changed voices need regenerating */
+  guint64 fingerprint = fingerprint_layout (gui, sb, all_movements);
+  gboolean incremental = fingerprints_valid && (fingerprint == layout_fingerprint) && Denemo.textbuffer && !gtk_text_buffer_get_modified (Denemo.textbuffer) && (gui->movement->markstaffnum == 0) && (continuous_typesetting () || !g_object_get_data (G_OBJECT (Denemo.textbuffer), "append"));
+  layout_fingerprint = fingerprint;
+  fingerprints_valid = FALSE;
+  if (!incremental)
     {
-      //FIXME  the working curmark at the end of the creation of the text
-      g_list_free (gui->anchors);
-      gui->anchors = NULL;
+      if (voice_fingerprints)
+        g_array_set_size (voice_fingerprints, 0);
+      if (music_sections)
+        g_hash_table_remove_all (music_sections);
     }
+  if (voice_fingerprints == NULL)
+    voice_fingerprints = g_array_new (FALSE, TRUE, sizeof (guint64));
 
+  GtkTextIter iter;
+  if (!incremental)
+    {
+      if (Denemo.textbuffer && (continuous_typesetting () || !g_object_get_data (G_OBJECT(Denemo.textbuffer), "append")))
+        gtk_text_buffer_set_text (Denemo.textbuffer, "", -1);
+      if (!Denemo.textbuffer)
+        warningdialog (_("No textbuffer"));
+      if (gui->anchors)
+        {
+          //FIXME  the working curmark at the end of the creation of the text
+          g_list_free (gui->anchors);
+          gui->anchors = NULL;
+        }
 
 
-  /* divide up the buffer for the various parts of the lily file */
-  GtkTextIter iter;
 
-  gtk_text_buffer_get_start_iter (Denemo.textbuffer, &iter);
+      /* divide up the buffer for the various parts of the lily file */
+
+      gtk_text_buffer_get_start_iter (Denemo.textbuffer, &iter);
 
-  insert_section (NULL, START, "Prolog", &iter, gui);
+      insert_section (NULL, START, "Prolog", &iter, gui);
 
-  gtk_text_buffer_get_end_iter (Denemo.textbuffer, &iter);
+      gtk_text_buffer_get_end_iter (Denemo.textbuffer, &iter);
 
-  insert_section (NULL, MUSIC, NULL, &iter, gui);
-  gtk_text_buffer_get_end_iter (Denemo.textbuffer, &iter);
+      insert_section (NULL, MUSIC, NULL, &iter, gui);
+      gtk_text_buffer_get_end_iter (Denemo.textbuffer, &iter);
 
-  insert_section (NULL, SCOREBLOCK, NULL, &iter, gui);
+      insert_section (NULL, SCOREBLOCK, NULL, &iter, gui);
 
-  gtk_text_buffer_get_iter_at_mark (Denemo.textbuffer, &iter, gtk_text_buffer_get_mark (Denemo.textbuffer, START));
-  gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, "\n", -1, "bold", NULL);
+      gtk_text_buffer_get_iter_at_mark (Denemo.textbuffer, &iter, gtk_text_buffer_get_mark (Denemo.textbuffer, START));
+      gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, "\n", -1, "bold", NULL);
 
 
-  {                             //no custom prolog
+      {                             //no custom prolog
 
-    GString *header = g_string_new ("");
-    outputHeader (header, gui);
-    gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, header->str, -1, INEDITABLE, NULL);
-    g_string_free (header, TRUE);
+        GString *header = g_string_new ("");
+        outputHeader (header, gui);
+        gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, header->str, -1, INEDITABLE, NULL);
+        g_string_free (header, TRUE);
 
-  }                             //end of standard prolog
+      }                             //end of standard prolog
 
-  {                             //Score prefix
+      {                             //Score prefix
 //    !!used in DenemoBar command (set barlines literally) along with postfix.
 //    change this script to have DENEMO_OVERRIDE_AFFIX set and then move all others to the score layout section
 
-    //Default value for barline = barline check
-    gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, LILYPOND_SYMBOL_DEFINITIONS, -1, INEDITABLE, NULL, NULL);
-    GList *g = gui->lilycontrol.directives;
-    /* num is not needed, as at the moment we can never get this location from LilyPond */
-    for (; g; g = g->next)
-      {
-        DenemoDirective *directive = g->data;
-        if (wrong_layout (directive, Denemo.project->layout_id))
-          continue;
-        if (directive->prefix && (directive->override & (DENEMO_OVERRIDE_AFFIX)))       //This used to be (mistakenly) DENEMO_ALT_OVERRIDE
-          insert_editable (&directive->prefix, directive->prefix->str, &iter, gui, NULL, TARGET_OBJECT, 0, 0, 0, 0, 0, 0);
-        //insert_section(&directive->prefix, directive->tag->str, NULL, &iter, gui);
+        //Default value for barline = barline check
+        gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, LILYPOND_SYMBOL_DEFINITIONS, -1, INEDITABLE, NULL, NULL);
+        GList *g = gui->lilycontrol.directives;
+        /* num is not needed, as at the moment we can never get this location from LilyPond */
+        for (; g; g = g->next)
+          {
+            DenemoDirective *directive = g->data;
+            if (wrong_layout (directive, Denemo.project->layout_id))
+              continue;
+            if (directive->prefix && (directive->override & (DENEMO_OVERRIDE_AFFIX)))       //This used to be (mistakenly) DENEMO_ALT_OVERRIDE
+              insert_editable (&directive->prefix, directive->prefix->str, &iter, gui, NULL, TARGET_OBJECT, 0, 0, 0, 0, 0, 0);
+            //insert_section(&directive->prefix, directive->tag->str, NULL, &iter, gui);
+          }
       }
-  }
 
-  gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, "\n% The music follows\n", -1, INEDITABLE, NULL);
+      gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, "\n" LILYPOND_MUSIC_FOLLOWS "\n", -1, INEDITABLE, NULL);
 
-  gtk_text_buffer_get_iter_at_mark (Denemo.textbuffer, &iter, gtk_text_buffer_get_mark (Denemo.textbuffer, SCOREBLOCK));
-  gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, "% The scoreblocks follow\n", -1, "bold", "system_invisible", NULL);
+      gtk_text_buffer_get_iter_at_mark (Denemo.textbuffer, &iter, gtk_text_buffer_get_mark (Denemo.textbuffer, SCOREBLOCK));
+      gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, "% The scoreblocks follow\n", -1, "bold", "system_invisible", NULL);
 
-  /* output scoreblock */
-  {
-    gchar *scoreblock_tag;
+      /* output scoreblock */
+      {
+        gchar *scoreblock_tag;
 #ifdef USE_EVINCE
-    if (continuous_typesetting ())
-      scoreblock_tag = "temporary scoreblock";
-    else
-      scoreblock_tag = "standard scoreblock";
+        if (continuous_typesetting ())
+          scoreblock_tag = "temporary scoreblock";
+        else
+          scoreblock_tag = "standard scoreblock";
 #else
-    scoreblock_tag = "standard scoreblock";
+        scoreblock_tag = "standard scoreblock";
 #endif
-    insert_scoreblock_section (gui, scoreblock_tag, sb);
-    gtk_text_buffer_get_iter_at_mark (Denemo.textbuffer, &iter, gtk_text_buffer_get_mark (Denemo.textbuffer, scoreblock_tag));
-    if (sb->text_only)
-      insert_editable (&sb->lilypond, g_strchomp ((sb->lilypond)->str), &iter, gui, 0, 0, 0, 0, 0, 0, 0, 0);    //without strchomp a newline is appended each refresh.
-    else
-      gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, (sb->lilypond)->str, -1, INEDITABLE, NULL);
-  }
-  /* insert standard scoreblock section */
-  //insert_scoreblock_section(gui, STANDARD_SCOREBLOCK, NULL);
+        insert_scoreblock_section (gui, scoreblock_tag, sb);
+        gtk_text_buffer_get_iter_at_mark (Denemo.textbuffer, &iter, gtk_text_buffer_get_mark (Denemo.textbuffer, scoreblock_tag));
+        if (sb->text_only)
+          insert_editable (&sb->lilypond, g_strchomp ((sb->lilypond)->str), &iter, gui, 0, 0, 0, 0, 0, 0, 0, 0);    //without strchomp a newline is appended each refresh.
+        else
+          gtk_text_buffer_insert_with_tags_by_name (Denemo.textbuffer, &iter, (sb->lilypond)->str, -1, INEDITABLE, NULL);
+      }
+      /* insert standard scoreblock section */
+      //insert_scoreblock_section(gui, STANDARD_SCOREBLOCK, NULL);
+    }                           /* end of text outside the music of the voices */
 
   GList *g;
   gint movement_count;
+  guint voice_index = 0;        //index into voice_fingerprints
   gint visible_movement;        /* 1 for visible -1 for invisible */
   for (g = gui->movements, movement_count = 1; g; g = g->next, movement_count++)
     {
@@ -2890,6 +3247,7 @@ output_score_to_buffer (DenemoProject * gui, gboolean all_movements, gchar * par
       gint voice_count;         //which voice counting from 1st voice of 1st staff thru to last voice of last staff.
       gint staff_count;         //which staff (not counting voices)
       visible_movement = (((all_movements) || (g->data == gui->movement)) ? 1 : -1);
+      section_movement = movement_count;
       GString *movement_name = g_string_new ("");
       GString *name = g_string_new ("");
       g_string_printf (name, "Mvmnt%d", movement_count);
@@ -2924,8 +3282,18 @@ output_score_to_buffer (DenemoProject * gui, gboolean all_movements, gchar * par
               start = gui->movement->selection.firstmeasuremarked;
               end = gui->movement->selection.lastmeasuremarked;
             }
+          guint64 voice_fingerprint = 0;
           if (visible_part > 0 && visible_movement > 0)
-            outputStaff (gui, curstaffstruct, start, end, movement_name->str, voice_name->str, movement_count * visible_movement, voice_count * visible_part, sb);
+            voice_fingerprint = fingerprint_voice (curstaffstruct, movement_count, voice_count, sb);
+          if (voice_index >= voice_fingerprints->len)
+            g_array_set_size (voice_fingerprints, voice_index + 1);
+          if (voice_fingerprint && (!incremental || (voice_fingerprint != g_array_index (voice_fingerprints, guint64, voice_index))))
+            {
+              regenerating_voice = incremental;
+              outputStaff (gui, curstaffstruct, start, end, movement_name->str, voice_name->str, movement_count * visible_movement, voice_count * visible_part, sb);
+              regenerating_voice = FALSE;
+            }
+          g_array_index (voice_fingerprints, guint64, voice_index++) = voice_fingerprint;
           //g_debug("Music for staff is \n%s\n", visible_part>0?"visible":"NOT visible");
 
           //FIXME amalgamate movement and voice names below here...
@@ -3003,7 +3371,7 @@ output_score_to_buffer (DenemoProject * gui, gboolean all_movements, gchar * par
 
 
 
-      if (visible_movement == 1)
+      if ((visible_movement == 1) && !incremental)
         {
 
 
@@ -3034,6 +3402,7 @@ output_score_to_buffer (DenemoProject * gui, gboolean all_movements, gchar * par
 
 
     }                           /* for each movement */
+  section_movement = 0;
 
 
   g_string_free (definitions, TRUE);
@@ -3045,7 +3414,7 @@ output_score_to_buffer (DenemoProject * gui, gboolean all_movements, gchar * par
       {
         GtkTextChildAnchor *anchor = g->data;
         GString **target = g_object_get_data (G_OBJECT (anchor), GSTRINGP);
-        if (target)
+        if (target && !g_object_get_data (G_OBJECT (anchor), ORIGINAL))
           g_object_set_data (G_OBJECT (anchor), ORIGINAL, get_text (anchor));
       }
 
@@ -3066,7 +3435,7 @@ output_score_to_buffer (DenemoProject * gui, gboolean all_movements, gchar * par
   }
 
   gtk_text_buffer_set_modified (Denemo.textbuffer, FALSE);
-
+  fingerprints_valid = (gui->movement->markstaffnum == 0);
 }                               /* output_score_to_buffer */
 
 
@@ -3135,37 +3504,50 @@ export_lilypond_part (char *filename, DenemoProject * gui, gboolean all_movement
   export_lilypond (filename, gui, all_movements, staff->lily_name->str, staff->denemo_name->str);
 }
 
+/* output lilypond for each part into a separate file filename_partname.ly (filename's extension, if any, is dropped)
+ * for the current movement or all movements.
+ * Returns the list of files written, each part once, for the caller to free.
+ */
+GList *
+export_lilypond_part_files (gchar * filename, DenemoProject * gui, gboolean all_movements)
+{
+  GList *files = NULL;
+  GHashTable *done = g_hash_table_new (g_str_hash, g_str_equal);
+  staffnode *curstaff;
+  gchar *base = g_strdup (filename);
+  gchar *extension = strrchr (base, '.');
+  if (extension && !strchr (extension, G_DIR_SEPARATOR))
+    *extension = '\0';
+  for (curstaff = gui->movement->thescore; curstaff; curstaff = curstaff->next)
+    {
+      DenemoStaff *curstaffstruct = (DenemoStaff *) curstaff->data;
+      gchar *partname = curstaffstruct->lily_name->str;
+      if (g_hash_table_contains (done, partname))
+        continue;
+      g_hash_table_add (done, partname);
+      gchar *staff_filename = g_strconcat (base, "_", partname, ".ly", NULL);
+      export_lilypond (staff_filename, gui, all_movements, partname, curstaffstruct->denemo_name->str);
+      files = g_list_append (files, staff_filename);
+    }
+  g_hash_table_destroy (done);
+  g_free (base);
+  return files;
+}
+
 /* output lilypond for each part into a separate file
  */
 void
 export_lilypond_parts (char *filename, DenemoProject * gui)
 {
-  gchar *staff_filename;
-  staffnode *curstaff;
-  DenemoStaff *curstaffstruct;
-  DenemoMovement *si = gui->movement;
-  for (curstaff = si->thescore; curstaff; curstaff = curstaff->next)
+  gchar *c = filename + strlen (filename);      // find .extension FIXME dots in filename
+  while (*c != '.' && c != filename)
+    c--;
+  if (c == filename)
     {
-
-      curstaffstruct = (DenemoStaff *) curstaff->data;
-      gchar *c = filename + strlen (filename);  // find .extension FIXME dots in filename
-      while (*c != '.' && c != filename)
-        c--;
-      if (c != filename)
-        *c = '\0';
-      else
-        {
-          warningdialog (_("Filename does not have extension"));
-          return;
-        }
-      staff_filename = g_strconcat (filename, "_", curstaffstruct->lily_name->str, ".ly", NULL);
-      *c = '.';
-      export_lilypond (staff_filename, gui, FALSE, ((DenemoStaff *) curstaff->data)->lily_name->str, ((DenemoStaff *) curstaff->data)->denemo_name->str);
-
+      warningdialog (_("Filename does not have extension"));
+      return;
     }
-
-  if (staff_filename)
-    g_free (staff_filename);
+  g_list_free_full (export_lilypond_part_files (filename, gui, FALSE), g_free);
 }
 
 /* callback on closing lilypond window */
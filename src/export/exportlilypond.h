@@ -15,10 +15,15 @@
 
 #define LILYPOND_SYMBOL_DEFINITIONS \
     "\nCompactChordSymbols = {}\n#(define DenemoTransposeStep 0)\n#(define DenemoTransposeAccidental 0)\nDenemoGlobalTranspose = \\void {}\ntitledPiece = {}\nAutoBarline = {}\nAutoEndMovementBarline = \\bar \"|.\"\n"
+
+/* the comment line that ends the prolog of the LilyPond text (the header and the score prefix), the music follows it */
+#define LILYPOND_MUSIC_FOLLOWS "% The music follows"
+
 void create_lilywindow (void);
 void exportlilypond (gchar * thefilename, DenemoProject * gui, gboolean all_movements);
 
 void export_lilypond_parts (char *filename, DenemoProject * gui);
+GList *export_lilypond_part_files (gchar * filename, DenemoProject * gui, gboolean all_movements);
 void export_lilypond_part (char *filename, DenemoProject * gui, gboolean all_movements);
 
 /* generate the LilyPond for the current part, all movements, into the LilyPond textview window */
@@ -29,6 +34,7 @@ void make_scoreblock_editable (void);
 gchar *generate_lily (objnode * obj);
 void refresh_lily_cb (DenemoAction * action, DenemoProject * gui);
 void force_lily_refresh (DenemoProject * gui);
+gboolean get_music_section_ranges (GArray * ranges);
 void toggle_lily_visible_cb (DenemoAction * action, gpointer param);
 
 void custom_lily_cb (DenemoAction * action, gpointer param);
@@ -24,7 +24,6 @@
 /* libxml includes: for libxml2 this should be <libxml/tree.h> */
 #include <libxml/tree.h>
 
-static gint OttavaVal = 0;
 #define XML_COMPRESSION_RATIO 3
 /**
  * return a child node of parent, holding the passed name and integer.
@@ -167,175 +166,35 @@ static void get_ottava (DenemoDirective *dir, gint *amount)
 
 
 /**
- * Export the given score as a MusicXML file thefilname
- returns 0 on success
+ * Output the i'th staff as a part element belonging to no document, so that each part can be output on its own.
  */
-gint
-exportmusicXML (gchar * thefilename, DenemoProject * gui)
+static xmlNodePtr
+export_part (DenemoStaff * curStaffStruct, gint i)
 {
-	gint ret = 0;
-	gint i, j, k;
-	GString *filename = g_string_new (thefilename);
-	xmlDocPtr doc;
-	xmlNodePtr scoreElem, mvmntElem, stavesElem, voicesElem, voiceElem;
-	xmlNodePtr measuresElem, measureElem;
-
-	xmlNodePtr curElem;
-	xmlNsPtr ns;
-	staffnode *curStaff;
-	DenemoStaff *curStaffStruct;
-	gchar *staffXMLID = 0, *voiceXMLID;
-	
+	gint j;
+	gchar *val;
+	gint ottava = 0;//the octave shift in force
+	xmlNsPtr ns = NULL;
+	xmlNodePtr measureElem;
 	measurenode *curMeasure;
-
-	static gchar *version_string;
-	if (version_string == NULL)
-	version_string = g_strdup_printf ("%d", CURRENT_XML_VERSION);
-
-	gboolean single_movement = (1 == g_list_length (gui->movements));
-	/* Initialize score-wide variables. */
-
-  /* Create the XML document and output the root element. */
-
-	doc = xmlNewDoc ((xmlChar *) "1.0");
-	xmlSetDocCompressMode (doc, Denemo.prefs.compression);
-	doc->xmlRootNode = scoreElem = xmlNewDocNode (doc, NULL, (xmlChar *) "score-partwise", NULL);
-	ns = NULL;
-
-  //<work>
-    //<work-number>D. 839</work-number>
-    //<work-title>Ave Maria (Ellen's Gesang III) - Page 1</work-title>
-  //</work>
-
-//<identification>
-    //<creator type="composer">Franz Schubert</creator>
-    
-    xmlNodePtr workElem = xmlNewChild (scoreElem, ns, (xmlChar *) "work", NULL);
-    
-	xmlNodePtr identificationElem = xmlNewChild (scoreElem, ns, (xmlChar *) "identification", NULL);
-	
-
-
-	DenemoDirective *dir = get_header_directive ("MovementTitles");
-	if (dir)
-		{
-			GString *data = (GString*)(dir->data);
-			if (data)
-				{
-					gchar *field = extract_field (data->str, "(cons 'title \""); 
-					if (field && *field)
-						{
-							xmlNewChild (scoreElem, ns, (xmlChar *) "movement-title", field);
-							g_free (field);
-						}
-					field = extract_field (data->str, "(cons 'composer \"");
-					if (field && *field)
-						{
-							xmlNodePtr creatorElem = xmlNewChild (identificationElem, ns, (xmlChar *) "creator", (xmlChar *) field);
-							xmlSetProp (creatorElem, (xmlChar *) "type",(xmlChar *)"composer");
-							g_free (field);
-						}	
-				}	
-		}
-		
-    dir = get_scoreheader_directive ("ScoreTitles");
-	if (dir)
-		{
-			GString *data = (GString*)(dir->data);
-			if (data)
-				{
-					gchar *field = extract_field (data->str, "(cons 'title \""); 
-					if (field && *field)
-						{
-							if (single_movement)
-								xmlNewChild (scoreElem, ns, (xmlChar *) "movement-title", field);
-							else
-								xmlNewChild (workElem, ns, (xmlChar *) "work-title", field);
-							g_free (field);
-						}
-					field = extract_field (data->str, "(cons 'composer \"");
-					if (field && *field)
-						{
-							xmlNodePtr creatorElem = xmlNewChild (identificationElem, ns, (xmlChar *) "creator", (xmlChar *) field);
-							xmlSetProp (creatorElem, (xmlChar *) "type",(xmlChar *)"composer");
-							g_free (field);
-						}	
-
-				}	
-		}		
-    dir = get_scoreheader_directive ("BookTitle");
-	if (dir)
-		{
-			GString *data = (GString*)(dir->display);
-			if (data && data->len)
-				{
-		
-					if (single_movement)
-						xmlNewChild (scoreElem, ns, (xmlChar *) "movement-title", data->str);
-					else
-						xmlNewChild (workElem, ns, (xmlChar *) "work-title", data->str);
-				}	
-		}
-    dir = get_scoreheader_directive ("BookComposer");
-	if (dir)
-		{
-			GString *data = (GString*)(dir->display);
-			if (data && data->len)
-				{
-				xmlNodePtr creatorElem = xmlNewChild (identificationElem, ns, (xmlChar *) "creator", (xmlChar *) data->str);
-				xmlSetProp (creatorElem, (xmlChar *) "type",(xmlChar *)"composer");
-				}	
-		}		
-    dir = get_movementcontrol_directive ("TitledPiece");
-	if (dir)
-		{
-			GString *data = (GString*)(dir->data);
-			if (data && data->len)
-				{
-						xmlNewChild (scoreElem, ns, (xmlChar *) "movement-title", data->str);
-				}	
-		}		
-					
-	xmlNodePtr encodingElem = xmlNewChild (identificationElem, ns, (xmlChar *) "encoding", NULL);
-	xmlNodePtr suppElem = xmlNewChild (encodingElem, ns, (xmlChar *) "supports", NULL);
-	xmlSetProp (suppElem, (xmlChar *) "element", (xmlChar *) "beam");
-	xmlSetProp (suppElem, (xmlChar *) "type", (xmlChar *) "yes");
-	suppElem = xmlNewChild (encodingElem, ns, (xmlChar *) "supports", NULL);
-	xmlSetProp (suppElem, (xmlChar *) "element", (xmlChar *) "accidental");
-	xmlSetProp (suppElem, (xmlChar *) "type", (xmlChar *) "yes");
-
-
-  DenemoMovement *si = gui->movement; // FIXME loop for movements
-  xmlNodePtr partListElem = xmlNewChild (scoreElem, ns, (xmlChar *) "part-list", NULL);
-		// give part ids and attributes for the staffs the ids
-		//   <score-part id="P1">
-  for (i=0, curStaff = si->thescore; curStaff != NULL; i++, curStaff = curStaff->next)
-        {
-			xmlNodePtr scorePartElem = xmlNewChild (partListElem, ns, (xmlChar *) "score-part", NULL);
-			gchar *val = g_strdup_printf ("P%d", i+1);
-			xmlSetProp (scorePartElem, (xmlChar *) "id", val);
-			g_free (val); 
-			xmlNewChild (scorePartElem, ns, (xmlChar *) "part-name", "Voice");	   //FIXME use Denemo part name... do instrument name as well?	   
-		  }
- 		
-  for (i=0, curStaff = si->thescore; curStaff != NULL; i++, curStaff = curStaff->next)
-        {
 		  gint nthTime = 1;//which nth time repeat bar been started. Used by EndVolta which does not carry the information
 		  xmlNodePtr partElem;
-          curStaffStruct = (DenemoStaff *) curStaff->data;
 		  gboolean tuplet_start = FALSE, in_tuplet = FALSE;
 		  gboolean in_tie = FALSE;		  
-		  OttavaVal = 0;
 //output the i'th staff
-	      partElem = xmlNewChild (scoreElem, ns, (xmlChar *) "part", NULL);
-	      xmlSetProp (partElem, (xmlChar *) "id", (xmlChar *) g_strdup_printf ("P%d", i+1));
+	      partElem = xmlNewNode (ns, (xmlChar *) "part");
+	      val = g_strdup_printf ("P%d", i+1);
+	      xmlSetProp (partElem, (xmlChar *) "id", (xmlChar *) val);
+	      g_free (val);
 //output measures
 
           for (j=0, curMeasure = curStaffStruct->themeasures; curMeasure != NULL; j++, curMeasure = curMeasure->next)
             {
               DenemoMeasure *themeasure = (DenemoMeasure *) curMeasure->data;
               measureElem = xmlNewChild (partElem, ns, (xmlChar *) "measure", NULL);
-			  xmlSetProp (measureElem, (xmlChar *) "number", (xmlChar *) g_strdup_printf ("%d", j+1));
+			  val = g_strdup_printf ("%d", j+1);
+			  xmlSetProp (measureElem, (xmlChar *) "number", (xmlChar *) val);
+			  g_free (val);
 
 //output initial clef, time key in first measure
 
@@ -435,7 +294,7 @@ exportmusicXML (gchar * thefilename, DenemoProject * gui)
 									  xmlNewTextChild (pitchElem, ns, (xmlChar *) "step", (xmlChar *) val); //the note-name from curnote
 									  g_free(val);
 									  newXMLIntChild (pitchElem, ns, (xmlChar *) "alter", curnote->enshift);
-									  newXMLIntChild (pitchElem, ns, (xmlChar *) "octave", -OttavaVal + 3+mid_c_offsettooctave (curnote->mid_c_offset)); //the octave from curnote
+									  newXMLIntChild (pitchElem, ns, (xmlChar *) "octave", -ottava + 3+mid_c_offsettooctave (curnote->mid_c_offset)); //the octave from curnote
 								  } else
 								  {
 									xmlNewChild (noteElem, ns, (xmlChar *) "rest", NULL); 
@@ -853,7 +712,7 @@ exportmusicXML (gchar * thefilename, DenemoProject * gui)
 									xmlNodePtr octElem = xmlNewChild (directionTypeElem, ns, (xmlChar *) "octave-shift", NULL);
 									gint amount;
 									get_ottava(dir, &amount);
-									OttavaVal = amount;
+									ottava = amount;
 									if (amount)
 										xmlSetProp (octElem, (xmlChar *) "type", amount>0?(xmlChar *) "up":(xmlChar *) "down");
 									else
@@ -876,20 +735,502 @@ exportmusicXML (gchar * thefilename, DenemoProject * gui)
 			 }//for each object
 		}//for each measure
 
-	}//for each staff
+	return partElem;
+}
+
+/* The parts are made into MusicXML text this many at a time, each on its own thread,
+ * and written out in order, so that only the text of these parts is held in memory rather than the whole score.
+ */
+typedef struct MusicXMLPart
+{
+  DenemoStaff *staff;
+  gint number;
+  xmlBufferPtr text;
+} MusicXMLPart;
+
+static gpointer
+render_part (MusicXMLPart * part)
+{
+  xmlDocPtr doc = xmlNewDoc ((xmlChar *) "1.0");
+  xmlNodePtr partElem = export_part (part->staff, part->number);
+  xmlSaveCtxt *ctxt;
+  xmlDocSetRootElement (doc, partElem);
+  part->text = xmlBufferCreate ();
+  ctxt = xmlSaveToBuffer (part->text, "UTF-8", XML_SAVE_FORMAT | XML_SAVE_NO_EMPTY);
+  if (ctxt)
+    {
+      xmlSaveTree (ctxt, partElem);
+      xmlSaveClose (ctxt);
+    }
+  xmlFreeDoc (doc);
+  return NULL;
+}
+
+/* A .mxl file is a zip archive holding the MusicXML compressed, a mimetype and a META-INF/container.xml pointing to the score.
+ * The score is compressed as it is written, its sizes and checksum following it in a data descriptor.
+ */
+#define MXL_SCORE_NAME "score.musicxml"
+#define MXL_MIMETYPE "application/vnd.recordare.musicxml"
+#define MXL_CONTAINER "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<container>\n  <rootfiles>\n    <rootfile full-path=\"" MXL_SCORE_NAME "\" media-type=\"application/vnd.recordare.musicxml+xml\"/>\n  </rootfiles>\n</container>\n"
+
+typedef struct ZipEntry
+{
+  gchar *name;
+  guint16 flags;
+  guint16 method;
+  guint32 crc;
+  guint32 compressed;
+  guint32 size;
+  guint32 offset;
+} ZipEntry;
+
+typedef struct MusicXMLOutput
+{
+  GOutputStream *file;
+  GOutputStream *stream;        //where the MusicXML goes, the file itself or, for .mxl, a compressor writing into it
+  GList *entries;               //for .mxl the ZipEntry written, last first
+  ZipEntry *entry;              //the entry the MusicXML is going to, NULL for plain MusicXML
+  goffset data_start;
+  guint16 time, date;
+  gboolean failed;
+} MusicXMLOutput;
+
+static guint32
+update_crc (guint32 crc, const guchar * buf, gsize len)
+{
+  static guint32 table[256];
+  if (table[1] == 0)
+    {
+      guint32 n, k, c;
+      for (n = 0; n < 256; n++)
+        {
+          for (c = n, k = 0; k < 8; k++)
+            c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+          table[n] = c;
+        }
+    }
+  crc = ~crc;
+  while (len--)
+    crc = table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+static void
+put16 (GByteArray * bytes, guint16 value)
+{
+  guint8 data[2] = { value & 0xff, value >> 8 };
+  g_byte_array_append (bytes, data, 2);
+}
+
+static void
+put32 (GByteArray * bytes, guint32 value)
+{
+  put16 (bytes, value & 0xffff);
+  put16 (bytes, value >> 16);
+}
+
+static void
+write_bytes (MusicXMLOutput * out, GOutputStream * stream, const guchar * data, gsize len)
+{
+  if (!out->failed && !g_output_stream_write_all (stream, data, len, NULL, NULL, NULL))
+    out->failed = TRUE;
+}
+
+static void
+write_output (MusicXMLOutput * out, const gchar * text, gsize len)
+{
+  write_bytes (out, out->stream, (const guchar *) text, len);
+  if (out->entry)
+    {
+      out->entry->crc = update_crc (out->entry->crc, (const guchar *) text, len);
+      out->entry->size += len;
+    }
+}
+
+/* the fields common to the local and central headers of a zip entry */
+static void
+put_entry_fields (GByteArray * bytes, MusicXMLOutput * out, ZipEntry * entry)
+{
+  put16 (bytes, 20);            //version needed to extract
+  put16 (bytes, entry->flags);
+  put16 (bytes, entry->method);
+  put16 (bytes, out->time);
+  put16 (bytes, out->date);
+  put32 (bytes, entry->crc);
+  put32 (bytes, entry->compressed);
+  put32 (bytes, entry->size);
+  put16 (bytes, strlen (entry->name));
+  put16 (bytes, 0);             //extra field length
+}
+
+static ZipEntry *
+begin_zip_entry (MusicXMLOutput * out, const gchar * name, guint16 method, guint16 flags)
+{
+  ZipEntry *entry = (ZipEntry *) g_malloc0 (sizeof (ZipEntry));
+  entry->name = g_strdup (name);
+  entry->method = method;
+  entry->flags = flags;
+  entry->offset = g_seekable_tell (G_SEEKABLE (out->file));
+  out->entries = g_list_prepend (out->entries, entry);
+  return entry;
+}
+
+static void
+write_local_header (MusicXMLOutput * out, ZipEntry * entry)
+{
+  GByteArray *bytes = g_byte_array_new ();
+  put32 (bytes, 0x04034b50);
+  put_entry_fields (bytes, out, entry);
+  g_byte_array_append (bytes, (guint8 *) entry->name, strlen (entry->name));
+  write_bytes (out, out->file, bytes->data, bytes->len);
+  g_byte_array_free (bytes, TRUE);
+}
+
+/* write an entry whose content is known beforehand, uncompressed */
+static void
+write_stored_entry (MusicXMLOutput * out, const gchar * name, const gchar * content)
+{
+  ZipEntry *entry = begin_zip_entry (out, name, 0, 0);
+  entry->size = entry->compressed = strlen (content);
+  entry->crc = update_crc (0, (const guchar *) content, entry->size);
+  write_local_header (out, entry);
+  write_bytes (out, out->file, (const guchar *) content, entry->size);
+}
+
+/* start the entry for the score, the MusicXML written after this is deflated into it */
+static void
+begin_score_entry (MusicXMLOutput * out)
+{
+  GConverter *compressor = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, -1));
+  out->entry = begin_zip_entry (out, MXL_SCORE_NAME, 8, 0x0008);        //deflated, sizes in a data descriptor
+  write_local_header (out, out->entry);
+  out->data_start = g_seekable_tell (G_SEEKABLE (out->file));
+  out->stream = g_converter_output_stream_new (out->file, compressor);
+  g_filter_output_stream_set_close_base_stream (G_FILTER_OUTPUT_STREAM (out->stream), FALSE);
+  g_object_unref (compressor);
+}
+
+static void
+end_score_entry (MusicXMLOutput * out)
+{
+  GByteArray *bytes = g_byte_array_new ();
+  if (!g_output_stream_close (out->stream, NULL, NULL))
+    out->failed = TRUE;
+  g_object_unref (out->stream);
+  out->stream = out->file;
+  out->entry->compressed = g_seekable_tell (G_SEEKABLE (out->file)) - out->data_start;
+  put32 (bytes, 0x08074b50);
+  put32 (bytes, out->entry->crc);
+  put32 (bytes, out->entry->compressed);
+  put32 (bytes, out->entry->size);
+  write_bytes (out, out->file, bytes->data, bytes->len);
+  g_byte_array_free (bytes, TRUE);
+  out->entry = NULL;
+}
+
+static void
+write_central_directory (MusicXMLOutput * out)
+{
+  GByteArray *bytes = g_byte_array_new ();
+  guint32 start = g_seekable_tell (G_SEEKABLE (out->file));
+  GList *g;
+  out->entries = g_list_reverse (out->entries);
+  for (g = out->entries; g; g = g->next)
+    {
+      ZipEntry *entry = (ZipEntry *) g->data;
+      put32 (bytes, 0x02014b50);
+      put16 (bytes, 20);        //version made by
+      put_entry_fields (bytes, out, entry);
+      put16 (bytes, 0);         //comment length
+      put16 (bytes, 0);         //disk number
+      put16 (bytes, 0);         //internal attributes
+      put32 (bytes, 0);         //external attributes
+      put32 (bytes, entry->offset);
+      g_byte_array_append (bytes, (guint8 *) entry->name, strlen (entry->name));
+    }
+  put32 (bytes, 0x06054b50);
+  put16 (bytes, 0);
+  put16 (bytes, 0);
+  put16 (bytes, g_list_length (out->entries));
+  put16 (bytes, g_list_length (out->entries));
+  put32 (bytes, bytes->len - 12);       //the size of the central directory, which is all but the end record written so far
+  put32 (bytes, start);
+  put16 (bytes, 0);             //comment length
+  write_bytes (out, out->file, bytes->data, bytes->len);
+  g_byte_array_free (bytes, TRUE);
+}
+
+static void
+free_zip_entry (ZipEntry * entry)
+{
+  g_free (entry->name);
+  g_free (entry);
+}
+
+/* open filename for the MusicXML, as a .mxl zip archive if mxl */
+static gboolean
+open_output (MusicXMLOutput * out, gchar * filename, gboolean mxl)
+{
+  GFile *file = g_file_new_for_path (filename);
+  memset (out, 0, sizeof (MusicXMLOutput));
+  out->file = out->stream = (GOutputStream *) g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, NULL);
+  g_object_unref (file);
+  if (out->file == NULL)
+    return FALSE;
+  if (mxl)
+    {
+      GDateTime *now = g_date_time_new_now_local ();
+      out->time = (g_date_time_get_hour (now) << 11) | (g_date_time_get_minute (now) << 5) | (g_date_time_get_second (now) / 2);
+      out->date = ((g_date_time_get_year (now) - 1980) << 9) | (g_date_time_get_month (now) << 5) | g_date_time_get_day_of_month (now);
+      g_date_time_unref (now);
+      write_stored_entry (out, "mimetype", MXL_MIMETYPE);
+      write_stored_entry (out, "META-INF/container.xml", MXL_CONTAINER);
+      begin_score_entry (out);
+    }
+  return TRUE;
+}
+
+/* finish the file, returning FALSE if anything could not be written */
+static gboolean
+close_output (MusicXMLOutput * out)
+{
+  if (out->entry)
+    {
+      end_score_entry (out);
+      write_central_directory (out);
+    }
+  if (!g_output_stream_close (out->file, NULL, NULL))
+    out->failed = TRUE;
+  g_object_unref (out->file);
+  g_list_free_full (out->entries, (GDestroyNotify) free_zip_entry);
+  return !out->failed;
+}
+
+/* write the parts for the staffs of si, making several at once on separate threads */
+static void
+write_parts (MusicXMLOutput * out, DenemoMovement * si)
+{
+  gint window = 1;
+  MusicXMLPart *parts;
+  GThread **threads;
+  staffnode *curStaff = si->thescore;
+  gint i = 0, n, k;
+#if GLIB_CHECK_VERSION(2,36,0)
+  window = g_get_num_processors ();
+#endif
+  parts = g_new0 (MusicXMLPart, window);
+  threads = g_new0 (GThread *, window);
+  while (curStaff)
+    {
+      for (n = 0; curStaff && (n < window); n++, i++, curStaff = curStaff->next)
+        {
+          parts[n].staff = (DenemoStaff *) curStaff->data;
+          parts[n].number = i;
+          threads[n] = (window > 1) ? g_thread_try_new ("MusicXML part", (GThreadFunc) render_part, parts + n, NULL) : NULL;
+          if (threads[n] == NULL)
+            render_part (parts + n);
+        }
+      for (k = 0; k < n; k++)
+        {
+          if (threads[k])
+            g_thread_join (threads[k]);
+          write_output (out, (const gchar *) xmlBufferContent (parts[k].text), xmlBufferLength (parts[k].text));
+          write_output (out, "\n", 1);
+          xmlBufferFree (parts[k].text);
+        }
+    }
+  g_free (threads);
+  g_free (parts);
+}
+
+/**
+ * Export the given score as a MusicXML file thefilname
+ returns 0 on success
+ */
+gint
+exportmusicXML (gchar * thefilename, DenemoProject * gui)
+{
+	gint ret = 0;
+	gint i, j, k;
+	GString *filename = g_string_new (thefilename);
+	xmlDocPtr doc;
+	xmlNodePtr scoreElem, mvmntElem, stavesElem, voicesElem, voiceElem;
+	xmlNodePtr measuresElem, measureElem;
+
+	xmlNodePtr curElem;
+	xmlNsPtr ns;
+	staffnode *curStaff;
+	DenemoStaff *curStaffStruct;
+	gchar *staffXMLID = 0, *voiceXMLID;
+	
+	measurenode *curMeasure;
+
+	static gchar *version_string;
+	if (version_string == NULL)
+	version_string = g_strdup_printf ("%d", CURRENT_XML_VERSION);
+
+	gboolean single_movement = (1 == g_list_length (gui->movements));
+	/* Initialize score-wide variables. */
+
+  /* Create the XML document and output the root element. */
+
+	xmlInitParser ();//before the parts are made on other threads
+	doc = xmlNewDoc ((xmlChar *) "1.0");
+	doc->xmlRootNode = scoreElem = xmlNewDocNode (doc, NULL, (xmlChar *) "score-partwise", NULL);
+	ns = NULL;
+
+  //<work>
+    //<work-number>D. 839</work-number>
+    //<work-title>Ave Maria (Ellen's Gesang III) - Page 1</work-title>
+  //</work>
+
+//<identification>
+    //<creator type="composer">Franz Schubert</creator>
+    
+    xmlNodePtr workElem = xmlNewChild (scoreElem, ns, (xmlChar *) "work", NULL);
+    
+	xmlNodePtr identificationElem = xmlNewChild (scoreElem, ns, (xmlChar *) "identification", NULL);
+	
+
+
+	DenemoDirective *dir = get_header_directive ("MovementTitles");
+	if (dir)
+		{
+			GString *data = (GString*)(dir->data);
+			if (data)
+				{
+					gchar *field = extract_field (data->str, "(cons 'title \""); 
+					if (field && *field)
+						{
+							xmlNewChild (scoreElem, ns, (xmlChar *) "movement-title", field);
+							g_free (field);
+						}
+					field = extract_field (data->str, "(cons 'composer \"");
+					if (field && *field)
+						{
+							xmlNodePtr creatorElem = xmlNewChild (identificationElem, ns, (xmlChar *) "creator", (xmlChar *) field);
+							xmlSetProp (creatorElem, (xmlChar *) "type",(xmlChar *)"composer");
+							g_free (field);
+						}	
+				}	
+		}
+		
+    dir = get_scoreheader_directive ("ScoreTitles");
+	if (dir)
+		{
+			GString *data = (GString*)(dir->data);
+			if (data)
+				{
+					gchar *field = extract_field (data->str, "(cons 'title \""); 
+					if (field && *field)
+						{
+							if (single_movement)
+								xmlNewChild (scoreElem, ns, (xmlChar *) "movement-title", field);
+							else
+								xmlNewChild (workElem, ns, (xmlChar *) "work-title", field);
+							g_free (field);
+						}
+					field = extract_field (data->str, "(cons 'composer \"");
+					if (field && *field)
+						{
+							xmlNodePtr creatorElem = xmlNewChild (identificationElem, ns, (xmlChar *) "creator", (xmlChar *) field);
+							xmlSetProp (creatorElem, (xmlChar *) "type",(xmlChar *)"composer");
+							g_free (field);
+						}	
+
+				}	
+		}		
+    dir = get_scoreheader_directive ("BookTitle");
+	if (dir)
+		{
+			GString *data = (GString*)(dir->display);
+			if (data && data->len)
+				{
+		
+					if (single_movement)
+						xmlNewChild (scoreElem, ns, (xmlChar *) "movement-title", data->str);
+					else
+						xmlNewChild (workElem, ns, (xmlChar *) "work-title", data->str);
+				}	
+		}
+    dir = get_scoreheader_directive ("BookComposer");
+	if (dir)
+		{
+			GString *data = (GString*)(dir->display);
+			if (data && data->len)
+				{
+				xmlNodePtr creatorElem = xmlNewChild (identificationElem, ns, (xmlChar *) "creator", (xmlChar *) data->str);
+				xmlSetProp (creatorElem, (xmlChar *) "type",(xmlChar *)"composer");
+				}	
+		}		
+    dir = get_movementcontrol_directive ("TitledPiece");
+	if (dir)
+		{
+			GString *data = (GString*)(dir->data);
+			if (data && data->len)
+				{
+						xmlNewChild (scoreElem, ns, (xmlChar *) "movement-title", data->str);
+				}	
+		}		
+					
+	xmlNodePtr encodingElem = xmlNewChild (identificationElem, ns, (xmlChar *) "encoding", NULL);
+	xmlNodePtr suppElem = xmlNewChild (encodingElem, ns, (xmlChar *) "supports", NULL);
+	xmlSetProp (suppElem, (xmlChar *) "element", (xmlChar *) "beam");
+	xmlSetProp (suppElem, (xmlChar *) "type", (xmlChar *) "yes");
+	suppElem = xmlNewChild (encodingElem, ns, (xmlChar *) "supports", NULL);
+	xmlSetProp (suppElem, (xmlChar *) "element", (xmlChar *) "accidental");
+	xmlSetProp (suppElem, (xmlChar *) "type", (xmlChar *) "yes");
+
+
+  DenemoMovement *si = gui->movement; // FIXME loop for movements
+  xmlNodePtr partListElem = xmlNewChild (scoreElem, ns, (xmlChar *) "part-list", NULL);
+		// give part ids and attributes for the staffs the ids
+		//   <score-part id="P1">
+  for (i=0, curStaff = si->thescore; curStaff != NULL; i++, curStaff = curStaff->next)
+        {
+			xmlNodePtr scorePartElem = xmlNewChild (partListElem, ns, (xmlChar *) "score-part", NULL);
+			gchar *val = g_strdup_printf ("P%d", i+1);
+			xmlSetProp (scorePartElem, (xmlChar *) "id", val);
+			g_free (val); 
+			xmlNewChild (scorePartElem, ns, (xmlChar *) "part-name", "Voice");	   //FIXME use Denemo part name... do instrument name as well?	   
+		  }
+ 		
 
    // for each movement not done
-  /* Save the file. */
+  /* Save the file, writing the parts one after another as they are made rather than building the whole document first. */
 
-  xmlSaveCtxt *ctxt = xmlSaveToFilename (filename->str, "UTF-8", XML_SAVE_FORMAT | XML_SAVE_NO_EMPTY);
-  if (!ctxt || xmlSaveDoc (ctxt, doc) < 0 || xmlSaveClose (ctxt) < 0)
+  xmlBufferPtr header = xmlBufferCreate ();
+  xmlSaveCtxt *ctxt = xmlSaveToBuffer (header, "UTF-8", XML_SAVE_FORMAT | XML_SAVE_NO_EMPTY);
+  MusicXMLOutput out;
+  gchar *lower = g_ascii_strdown (filename->str, -1);
+  if (ctxt)
+    {
+      xmlSaveDoc (ctxt, doc);
+      xmlSaveClose (ctxt);
+    }
+  const gchar *text = (const gchar *) xmlBufferContent (header);
+  const gchar *end = text ? g_strrstr (text, "</score-partwise>") : NULL;
+  if (end == NULL || !open_output (&out, filename->str, g_str_has_suffix (lower, ".mxl")))
     {
       g_warning ("Could not save file %s", filename->str);
       ret = -1;
     }
+  else
+    {
+      write_output (&out, text, end - text);
+      write_parts (&out, si);
+      write_output (&out, end, strlen (end));
+      if (!close_output (&out))
+        {
+          g_warning ("Could not save file %s", filename->str);
+          ret = -1;
+        }
+    }
 
   /* Clean up all the memory we've allocated. */
 
+  g_free (lower);
+  xmlBufferFree (header);
   xmlFreeDoc (doc);
   g_string_free (filename, TRUE);
   return ret;
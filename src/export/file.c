@@ -595,6 +595,8 @@ create_filename (const gchar * file_name, gint format_id)
 {
   if (g_pattern_match_simple (FORMAT_MASK (format_id), file_name))
     return (g_strdup (file_name));
+  if ((format_id == MUSICXML_FORMAT) && (has_extension ((gchar *) file_name, ".mxl") || has_extension ((gchar *) file_name, ".musicxml")))
+    return (g_strdup (file_name));      //compressed MusicXML or the alternative extension
   else
     return (g_strconcat (file_name, FORMAT_EXTENSION (format_id), NULL));
 }
@@ -1025,6 +1027,17 @@ update_preview_cb (GtkFileChooser * file_chooser, gpointer data)
 #endif
 }
 
+//make thumbnails for the scores in the folder being browsed, so that previews are available
+static void
+update_folder_thumbnails_cb (GtkFileChooser * file_chooser, G_GNUC_UNUSED gpointer data)
+{
+#ifdef USE_EVINCE
+  gchar *folder = gtk_file_chooser_get_current_folder (file_chooser);
+  queue_directory_thumbnails (folder);
+  g_free (folder);
+#endif
+}
+
 static gboolean
 file_open_dialog(gchar* message, gchar* format, FileFormatNames save_type, DenemoSaveType template, ImportType type, gchar* filename){
   gboolean ret = -1;
@@ -1069,6 +1082,9 @@ file_open_dialog(gchar* message, gchar* format, FileFormatNames save_type, Denem
   g_signal_connect (GTK_FILE_CHOOSER(file_selection), "update-preview",
             G_CALLBACK (update_preview_cb), preview);
   gtk_widget_show_all (preview);
+  if (Denemo.prefs.enable_thumbnails)
+    g_signal_connect (GTK_FILE_CHOOSER(file_selection), "current-folder-changed",
+            G_CALLBACK (update_folder_thumbnails_cb), NULL);
   if (gtk_dialog_run (GTK_DIALOG (file_selection)) == GTK_RESPONSE_ACCEPT)
     {
       gchar *name = gtk_file_chooser_get_filename (GTK_FILE_CHOOSER (file_selection));
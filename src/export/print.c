@@ -540,6 +540,462 @@ open_pngviewer (G_GNUC_UNUSED GPid pid, gint status, gchar * filename)
 {
   open_viewer (status, filename);
 }
+/* Typeset cache
+ * The output LilyPond makes from a .ly text is kept in the typeset-cache directory of the
+ * user's data directory, one sub-directory per text, named by a checksum of the text together
+ * with the LilyPond version, include path and backend. Typesetting the same text again copies
+ * the output back instead of running LilyPond. Least recently used entries are discarded once
+ * Denemo.prefs.typeset_cache_size MB is exceeded.
+ */
+#define TYPESET_CACHE_DIR "typeset-cache"
+#define TYPESET_CACHE_STEM "output"     //replaces the print file basename in the cached copies
+
+typedef struct TypesetCacheEntry
+{
+  gchar *path;
+  time_t used;
+  guint64 size;
+} TypesetCacheEntry;
+
+typedef struct TypesetWatch
+{
+  GChildWatchFunc finish;
+  gpointer data;
+  GDestroyNotify destroy;       //frees data if finish is not called, or NULL
+  gchar *key;                   //cache key to store the output under on success, or NULL
+  gchar *basename;
+  gboolean svg;
+  time_t started;               //when LilyPond was started, older files in the print directory are not its output
+  guint generation;             //the generation of typesets for finish when this one started
+} TypesetWatch;
+
+static gchar *pending_cache_key = NULL; //key for the typeset just started, handed to the watch
+static gchar *pending_cache_basename = NULL;
+static gboolean pending_cache_svg = FALSE;
+static time_t pending_cache_started = 0;
+static gboolean served_from_cache = FALSE;      //the typeset just started was satisfied from the cache
+static GHashTable *typeset_generations = NULL;  //finish function -> count of typesets started for it, the output of a superseded one is never shown
+
+static gchar *
+typeset_cache_dir (void)
+{
+  gchar *dir = g_build_filename (get_user_data_dir (TRUE), TYPESET_CACHE_DIR, NULL);
+  g_mkdir_with_parents (dir, 0770);
+  return dir;
+}
+
+/* add the name, modification time and size of each file that text \include's to checksum, and of the files they include.
+ * A name is looked for in dir and the Denemo LilyPond include directories, every file found is added
+ * as it is not known which LilyPond will use. Files that are not found are part of LilyPond itself.
+ */
+static void
+checksum_included_files (GChecksum * checksum, const gchar * text, const gchar * dir, GHashTable * seen)
+{
+  static GRegex *regex = NULL;
+  GMatchInfo *match_info;
+  if (regex == NULL)
+    regex = g_regex_new ("\\\\include\\s*\"([^\"]+)\"", G_REGEX_OPTIMIZE, 0, NULL);
+  g_regex_match (regex, text, 0, &match_info);
+  while (g_match_info_matches (match_info))
+    {
+      gchar *name = g_match_info_fetch (match_info, 1);
+      const gchar *dirs[] = { dir, local_include + strlen ("-I"), include + strlen ("-I") };
+      guint i;
+      for (i = 0; i < G_N_ELEMENTS (dirs); i++)
+        {
+          struct stat thebuf;
+          gchar *path;
+          if ((*dirs[i] == 0) && !g_path_is_absolute (name))
+            continue;
+          path = g_path_is_absolute (name) ? g_strdup (name) : g_build_filename (dirs[i], name, NULL);
+          if ((g_stat (path, &thebuf) == 0) && !g_hash_table_contains (seen, path))
+            {
+              gchar *stamp = g_strdup_printf ("%s %" G_GINT64_FORMAT " %" G_GINT64_FORMAT, path, (gint64) thebuf.st_mtime, (gint64) thebuf.st_size);
+              gchar *contents;
+              g_checksum_update (checksum, (const guchar *) stamp, strlen (stamp) + 1);
+              g_free (stamp);
+              g_hash_table_add (seen, path);
+              if (g_file_get_contents (path, &contents, NULL, NULL))
+                {
+                  gchar *subdir = g_path_get_dirname (path);
+                  checksum_included_files (checksum, contents, subdir, seen);
+                  g_free (subdir);
+                  g_free (contents);
+                }
+            }
+          else
+            g_free (path);
+          if (g_path_is_absolute (name))
+            break;
+        }
+      g_free (name);
+      g_match_info_next (match_info, NULL);
+    }
+  g_match_info_free (match_info);
+}
+
+static gchar *
+typeset_cache_key (gchar * lilyfile, const gchar * backend)
+{
+  gchar *text;
+  gsize length;
+  if (!g_file_get_contents (lilyfile, &text, &length, NULL))
+    return NULL;
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  g_checksum_update (checksum, (const guchar *) text, length);
+  {
+    GHashTable *seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    gchar *dir = g_path_get_dirname (lilyfile);
+    checksum_included_files (checksum, text, dir, seen);
+    g_free (dir);
+    g_hash_table_destroy (seen);
+  }
+  g_free (text);
+  const gchar *context[] = { backend, Denemo.lilypond_installed_version ? Denemo.lilypond_installed_version : "", Denemo.prefs.lilypath->str, include, local_include };
+  guint i;
+  for (i = 0; i < G_N_ELEMENTS (context); i++)
+    g_checksum_update (checksum, (const guchar *) context[i], strlen (context[i]) + 1); //include the terminator so the fields cannot run together
+  gchar *key = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+  return key;
+}
+
+static gboolean
+copy_typeset_file (gchar * from, gchar * to)
+{
+  GFile *source = g_file_new_for_path (from);
+  GFile *dest = g_file_new_for_path (to);
+  gboolean success = g_file_copy (source, dest, G_FILE_COPY_OVERWRITE, NULL, NULL, NULL, NULL);
+  g_object_unref (source);
+  g_object_unref (dest);
+  return success;
+}
+
+static void
+remove_typeset_cache_entry (gchar * path)
+{
+  GDir *dir = g_dir_open (path, 0, NULL);
+  if (dir)
+    {
+      const gchar *name;
+      while ((name = g_dir_read_name (dir)))
+        {
+          gchar *file = g_build_filename (path, name, NULL);
+          g_unlink (file);
+          g_free (file);
+        }
+      g_dir_close (dir);
+    }
+  g_rmdir (path);
+}
+
+static guint64
+typeset_cache_entry_size (gchar * path)
+{
+  guint64 size = 0;
+  GDir *dir = g_dir_open (path, 0, NULL);
+  if (dir)
+    {
+      const gchar *name;
+      while ((name = g_dir_read_name (dir)))
+        {
+          struct stat thebuf;
+          gchar *file = g_build_filename (path, name, NULL);
+          if (g_stat (file, &thebuf) == 0)
+            size += thebuf.st_size;
+          g_free (file);
+        }
+      g_dir_close (dir);
+    }
+  return size;
+}
+
+static gint
+compare_typeset_cache_use (TypesetCacheEntry * a, TypesetCacheEntry * b)
+{
+  return (a->used > b->used) - (a->used < b->used);
+}
+
+/* discard the least recently used entries until the cache fits in Denemo.prefs.typeset_cache_size */
+static void
+trim_typeset_cache (gchar * cachedir)
+{
+  guint64 limit = (guint64) Denemo.prefs.typeset_cache_size * 1024 * 1024;
+  guint64 total = 0;
+  GList *entries = NULL, *g;
+  GDir *dir = g_dir_open (cachedir, 0, NULL);
+  if (dir == NULL)
+    return;
+  const gchar *name;
+  while ((name = g_dir_read_name (dir)))
+    {
+      struct stat thebuf;
+      TypesetCacheEntry *entry = (TypesetCacheEntry *) g_malloc (sizeof (TypesetCacheEntry));
+      entry->path = g_build_filename (cachedir, name, NULL);
+      entry->used = (g_stat (entry->path, &thebuf) == 0) ? thebuf.st_mtime : 0;
+      entry->size = typeset_cache_entry_size (entry->path);
+      total += entry->size;
+      entries = g_list_prepend (entries, entry);
+    }
+  g_dir_close (dir);
+  entries = g_list_sort (entries, (GCompareFunc) compare_typeset_cache_use);
+  for (g = entries; g; g = g->next)
+    {
+      TypesetCacheEntry *entry = (TypesetCacheEntry *) g->data;
+      if (total > limit)
+        {
+          remove_typeset_cache_entry (entry->path);
+          total -= entry->size;
+        }
+      g_free (entry->path);
+      g_free (entry);
+    }
+  g_list_free (entries);
+}
+
+/* copy the output stored under key into the print directory, named for basename. Returns TRUE if it was there */
+static gboolean
+fetch_from_typeset_cache (gchar * key, gchar * basename)
+{
+  gchar *cachedir = typeset_cache_dir ();
+  gchar *entry = g_build_filename (cachedir, key, NULL);
+  gboolean found = FALSE;
+  GDir *dir = g_dir_open (entry, 0, NULL);
+  g_free (cachedir);
+  if (dir)
+    {
+      const gchar *name;
+      while ((name = g_dir_read_name (dir)))
+        {
+          gchar *from = g_build_filename (entry, name, NULL);
+          gchar *to;
+          if (g_str_has_prefix (name, TYPESET_CACHE_STEM))
+            to = g_strconcat (basename, name + strlen (TYPESET_CACHE_STEM), NULL);
+          else
+            to = g_build_filename (locateprintdir (), name, NULL);
+          found = copy_typeset_file (from, to);
+          g_free (from);
+          g_free (to);
+          if (!found)
+            break;
+        }
+      g_dir_close (dir);
+      if (found)
+        g_utime (entry, NULL);  //mark as recently used
+    }
+  g_free (entry);
+  return found;
+}
+
+/* TRUE if LilyPond reported neither errors nor warnings, whose line numbers would refer to the .ly file of this cycle.
+ * Only LilyPond's own diagnostics count, "file:line:col: error: ..." or without the location, not text from the score that is echoed.
+ */
+static gboolean
+typeset_was_clean (gchar * basename)
+{
+  static GRegex *diagnostic = NULL;
+  gchar *logfile = g_strconcat (basename, ".log", NULL);
+  gchar *bytes = NULL;
+  gboolean clean = g_file_get_contents (logfile, &bytes, NULL, NULL);
+  g_free (logfile);
+  if (diagnostic == NULL)
+    diagnostic = g_regex_new ("^([^\\n]*:\\d+(:\\d+)?: )?((fatal |programming )?error|warning): ", G_REGEX_OPTIMIZE | G_REGEX_MULTILINE, 0, NULL);
+  if (clean)
+    {
+      gchar **lines = g_strsplit (bytes, "\n", -1);
+      gchar **line;
+      for (line = lines; clean && *line; line++)
+        clean = strstr (*line, "DenemoInfo=") || !g_regex_match (diagnostic, *line, 0, NULL);   //the page and system count is reported as a warning
+      g_strfreev (lines);
+    }
+  g_free (bytes);
+  return clean;
+}
+
+/* TRUE if the file name in printdir was written at or after started */
+static gboolean
+typeset_file_is_new (gchar * printdir, const gchar * name, time_t started)
+{
+  struct stat thebuf;
+  gchar *path = g_build_filename (printdir, name, NULL);
+  gboolean isnew = (g_stat (path, &thebuf) == 0) && (thebuf.st_mtime >= started);
+  g_free (path);
+  return isnew;
+}
+
+/* store the output of the typeset of basename started at started under key. Only files written since then are stored,
+ * pages left in the print directory by an earlier, longer typeset of the same basename are not part of this output */
+static void
+store_in_typeset_cache (gchar * key, gchar * basename, gboolean svg, time_t started)
+{
+  gchar *cachedir = typeset_cache_dir ();
+  gchar *entry = g_build_filename (cachedir, key, NULL);
+  gchar *partial = g_strconcat (entry, ".partial", NULL);
+  gchar *printdir = g_path_get_dirname (basename);
+  gchar *stem = g_path_get_basename (basename);
+  gboolean success = (g_mkdir_with_parents (partial, 0770) == 0);
+  GDir *dir = success ? g_dir_open (printdir, 0, NULL) : NULL;
+  if (dir)
+    {
+      const gchar *name;
+      while (success && (name = g_dir_read_name (dir)))
+        {
+          gchar *to = NULL;
+          if (!typeset_file_is_new (printdir, name, started))
+            continue;
+          if (g_str_has_prefix (name, stem) && !g_str_has_suffix (name, ".ly"))
+            to = g_strconcat (partial, G_DIR_SEPARATOR_S, TYPESET_CACHE_STEM, name + strlen (stem), NULL);
+          else if (svg && !strcmp (name, "events.txt"))
+            to = g_build_filename (partial, name, NULL);
+          if (to)
+            {
+              gchar *from = g_build_filename (printdir, name, NULL);
+              success = copy_typeset_file (from, to);
+              g_free (from);
+              g_free (to);
+            }
+        }
+      g_dir_close (dir);
+    }
+  else
+    success = FALSE;
+  if (success)
+    {
+      remove_typeset_cache_entry (entry);       //another typeset of the same text may have got there first
+      success = (g_rename (partial, entry) == 0);
+    }
+  if (!success)
+    remove_typeset_cache_entry (partial);
+  trim_typeset_cache (cachedir);
+  g_free (stem);
+  g_free (printdir);
+  g_free (partial);
+  g_free (entry);
+  g_free (cachedir);
+}
+
+/* look up the output for lilyfile in the typeset cache, copying it to basename on a hit.
+ * On a miss the key is kept so that watch_typeset () can store the output when LilyPond finishes.
+ */
+static gboolean
+typeset_from_cache (gchar * lilyfile, gchar * basename, gboolean svg)
+{
+  g_free (pending_cache_key);
+  pending_cache_key = NULL;
+  served_from_cache = FALSE;
+  if (Denemo.prefs.typeset_cache_size <= 0)
+    return FALSE;
+  gchar *key = typeset_cache_key (lilyfile, svg ? "svg" : "pdf");
+  if (key == NULL)
+    return FALSE;
+  if (fetch_from_typeset_cache (key, basename))
+    {
+      g_free (key);
+      Denemo.printstatus->pages = 0;
+      Denemo.printstatus->printpid = GPID_NONE;     //no LilyPond process belongs to this typeset
+      served_from_cache = TRUE;
+      return TRUE;
+    }
+  pending_cache_key = key;
+  pending_cache_basename = basename;
+  pending_cache_svg = svg;
+  pending_cache_started = time (NULL);
+  return FALSE;
+}
+
+/* the generation of the latest typeset watched with finish, each consumer (Print View, Playback View ...) has its own
+ * so that starting a typeset for one does not discard the output of another. */
+static guint
+typeset_generation (GChildWatchFunc finish)
+{
+  if (typeset_generations == NULL)
+    return 0;
+  return GPOINTER_TO_UINT (g_hash_table_lookup (typeset_generations, (gpointer) finish));
+}
+
+static guint
+next_typeset_generation (GChildWatchFunc finish)
+{
+  guint generation = typeset_generation (finish) + 1;
+  if (typeset_generations == NULL)
+    typeset_generations = g_hash_table_new (g_direct_hash, g_direct_equal);
+  g_hash_table_insert (typeset_generations, (gpointer) finish, GUINT_TO_POINTER (generation));
+  return generation;
+}
+
+/* dispose of the watch on a typeset that has been superseded, without calling its finish function */
+static void
+drop_typeset_watch (GPid pid, TypesetWatch * watch)
+{
+  if (pid != GPID_NONE)
+    g_spawn_close_pid (pid);
+  if (watch->destroy)
+    watch->destroy (watch->data);
+  g_free (watch->key);
+  g_free (watch);
+}
+
+static void
+typeset_child_finished (GPid pid, gint status, TypesetWatch * watch)
+{
+  if (watch->generation != typeset_generation (watch->finish))
+    {
+      drop_typeset_watch (pid, watch);  //it was killed by whatever superseded it, which will show its own output
+      return;
+    }
+  if (watch->key && (status == 0) && typeset_was_clean (watch->basename))
+    store_in_typeset_cache (watch->key, watch->basename, watch->svg, watch->started);
+  watch->finish (pid, status, watch->data);
+  g_free (watch->key);
+  g_free (watch);
+}
+
+static gboolean
+typeset_cache_hit_finished (TypesetWatch * watch)
+{
+  if (watch->generation != typeset_generation (watch->finish))
+    drop_typeset_watch (GPID_NONE, watch);
+  else
+    {
+      watch->finish (GPID_NONE, 0, watch->data);       //printpid was reset when the output was fetched
+      g_free (watch);
+    }
+  return FALSE;
+}
+
+/* Arrange for finish to be called when the typeset just started by create_pdf () or create_svg ()
+ * is complete, whether LilyPond is running or the output was taken from the typeset cache.
+ * finish is not called if another typeset watched with the same finish has been started meanwhile,
+ * instead destroy, if not NULL, is called on data.
+ */
+void
+watch_typeset_full (GChildWatchFunc finish, gpointer data, GDestroyNotify destroy)
+{
+  TypesetWatch *watch = (TypesetWatch *) g_malloc0 (sizeof (TypesetWatch));
+  watch->finish = finish;
+  watch->data = data;
+  watch->destroy = destroy;
+  watch->generation = next_typeset_generation (finish);
+  if (served_from_cache)
+    {
+      served_from_cache = FALSE;
+      g_idle_add ((GSourceFunc) typeset_cache_hit_finished, watch);
+      return;
+    }
+  watch->key = pending_cache_key;
+  watch->basename = pending_cache_basename;
+  watch->svg = pending_cache_svg;
+  watch->started = pending_cache_started;
+  pending_cache_key = NULL;
+  g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) typeset_child_finished, watch);
+}
+
+void
+watch_typeset (GChildWatchFunc finish, gpointer data)
+{
+  watch_typeset_full (finish, data, NULL);
+}
+
 static gboolean
 call_stop_lilypond (void)
 {
@@ -562,6 +1018,13 @@ run_lilypond (gchar ** arguments)
       old_error = FALSE;  
     }
   Denemo.printstatus->pages = 0;
+  served_from_cache = FALSE;
+  if (lily_err)
+    {
+      g_warning ("Old error message from launching lilypond still present - message was %s\nDiscarding...", lily_err->message);
+      g_error_free (lily_err);
+      lily_err = NULL;
+    }
   // Don't show progress bar if Print View is visible - the user is watching it already
   // and the progress bar steals focus, pushing Print View behind main window
   gboolean printview_visible = (Denemo.printarea && gtk_widget_get_visible(gtk_widget_get_toplevel(Denemo.printarea)));
@@ -572,12 +1035,6 @@ run_lilypond (gchar ** arguments)
       else
         progressbar (_("Denemo Typesetting"), call_stop_lilypond);  // Show separate progress window
     }
-  if (lily_err)
-    {
-      g_warning ("Old error message from launching lilypond still present - message was %s\nDiscarding...", lily_err->message);
-      g_error_free (lily_err);
-      lily_err = NULL;
-    }
 
   console_output (NULL);
   console_output (_("Typesetting ..."));
@@ -652,7 +1109,7 @@ generate_lilypond (gchar * lilyfile, gboolean part_only, gboolean all_movements)
 }
 
 // for populating the Print View, cf export_pdf ()
-static void
+static gint
 run_lilypond_for_pdf (gchar * filename, gchar * lilyfile)
 {
  // if(!include) initialize_lilypond_includes();
@@ -670,8 +1127,9 @@ run_lilypond_for_pdf (gchar * filename, gchar * lilyfile)
     lilyfile,
     NULL
   };
-  run_lilypond (arguments);
+  gint error = run_lilypond (arguments);
   g_free (logfile);
+  return error;
 }
 //synchronous generation of outfile.pdf from input lilyfile
 void generate_pdf_from_lily_file (gchar *lilyfile, gchar *outfile)
@@ -732,7 +1190,8 @@ create_pdf (gboolean part_only, gboolean all_movements)
   Denemo.printstatus->invalid = 0;
   g_free (Denemo.printstatus->error_file);Denemo.printstatus->error_file = NULL;
   generate_lilypond (lilyfile, part_only, all_movements);
-  run_lilypond_for_pdf (filename, lilyfile);
+  if (!typeset_from_cache (lilyfile, filename, FALSE))
+    run_lilypond_for_pdf (filename, lilyfile);
 }
 /*  create pdf of current score, optionally restricted to voices/staffs whose name match the current one.
  *  generate the lilypond text (on disk)
@@ -764,7 +1223,59 @@ create_svg (gboolean part_only, gboolean all_movements)
   Denemo.printstatus->invalid = 0;
   g_free (Denemo.printstatus->error_file);Denemo.printstatus->error_file = NULL;
   generate_lilypond (lilyfile, part_only, all_movements);
-  run_lilypond_for_svg (filename, lilyfile);
+  if (!typeset_from_cache (lilyfile, filename, TRUE))
+    run_lilypond_for_svg (filename, lilyfile);
+}
+
+/* typeset the LilyPond text lilypond to basename.pdf, using the typeset cache.
+ * finish is called when the typeset is complete, or destroy on data if it is superseded. Returns FALSE if LilyPond could not be run.
+ */
+gboolean
+typeset_lilypond_text (gchar * lilypond, gchar * basename, GChildWatchFunc finish, gpointer data, GDestroyNotify destroy)
+{
+  gchar *lilyfile = g_strconcat (basename, ".ly", NULL);
+  gchar *pdf = g_strconcat (basename, ".pdf", NULL);
+  gboolean success;
+  g_unlink (pdf);
+  g_free (pdf);
+  success = g_file_set_contents (lilyfile, lilypond, -1, NULL);
+  if (success && !typeset_from_cache (lilyfile, basename, FALSE))
+    success = (run_lilypond_for_pdf (basename, lilyfile) == 0);
+  if (success)
+    watch_typeset_full (finish, data, destroy);
+  g_free (lilyfile);
+  return success;
+}
+
+/* join the pdf files into the next print file for the Print View using ghostscript.
+ * finish is called when done. Returns FALSE if ghostscript could not be run.
+ */
+gboolean
+join_pdfs_for_print_view (GList * pdfs, GChildWatchFunc finish, gpointer data)
+{
+  gchar **arguments = (gchar **) g_malloc0 ((g_list_length (pdfs) + 7) * sizeof (gchar *));
+  GError *err = NULL;
+  gint i = 0;
+  advance_printname ();
+  arguments[i++] = g_strdup (Denemo.prefs.ghostscript->str);
+  arguments[i++] = g_strdup ("-q");
+  arguments[i++] = g_strdup ("-dBATCH");
+  arguments[i++] = g_strdup ("-dNOPAUSE");
+  arguments[i++] = g_strdup ("-sDEVICE=pdfwrite");
+  arguments[i++] = g_strdup_printf ("-sOutputFile=%s", Denemo.printstatus->printname_pdf[Denemo.printstatus->cycle]);
+  for (; pdfs; pdfs = pdfs->next)
+    arguments[i++] = g_strdup ((gchar *) pdfs->data);
+  gboolean success = g_spawn_async (locateprintdir (), arguments, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &Denemo.printstatus->printpid, &err);
+  if (success)
+    g_child_watch_add (Denemo.printstatus->printpid, finish, data);
+  else
+    {
+      g_warning ("Could not run %s to join the typeset movements: %s", arguments[0], err->message);
+      g_error_free (err);
+      Denemo.printstatus->printpid = GPID_NONE;
+    }
+  g_strfreev (arguments);
+  return success;
 }
 
 void create_pdf_for_lilypond (gchar *lilypond)
@@ -782,8 +1293,9 @@ void create_pdf_for_lilypond (gchar *lilypond)
   g_file_set_contents (lilyfile, lilypond, -1, NULL);
   Denemo.printstatus->invalid = 0;
   g_free (Denemo.printstatus->error_file);Denemo.printstatus->error_file = NULL;
-  run_lilypond_for_pdf (filename, lilyfile);
-  g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) markupview_finished, (gpointer) (FALSE));
+  if (!typeset_from_cache (lilyfile, filename, FALSE))
+    run_lilypond_for_pdf (filename, lilyfile);
+  watch_typeset ((GChildWatchFunc) markupview_finished, (gpointer) (FALSE));
 #endif
 }
 /**
@@ -1047,6 +1559,193 @@ export_pdf (gchar * filename, DenemoProject * gui)
     g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printpdf_finished, filelist);
 }
 
+/* Typesetting parts
+ * Each part is typeset to its own pdf by a separate LilyPond process, with at most
+ * Denemo.prefs.max_typeset_jobs running at once (0 for one per processor). These processes
+ * are independent of Denemo.printstatus->printpid, so the Print View can be used meanwhile.
+ */
+typedef struct PartJob
+{
+  gchar *lilyfile;
+  gchar *outbase;               //the pdf is outbase.pdf
+  GPid pid;
+} PartJob;
+
+static GQueue *waiting_parts = NULL;    //PartJobs not yet started, NULL when no parts are being typeset
+static GList *running_parts = NULL;     //PartJobs whose LilyPond is running
+static gint parts_total, parts_done, parts_failed;
+static gboolean parts_cancelled;
+
+static void
+free_part_job (PartJob * job)
+{
+  g_free (job->lilyfile);
+  g_free (job->outbase);
+  g_free (job);
+}
+
+static gint
+max_part_jobs (void)
+{
+  if (Denemo.prefs.max_typeset_jobs > 0)
+    return Denemo.prefs.max_typeset_jobs;
+#if GLIB_CHECK_VERSION(2,36,0)
+  return g_get_num_processors ();
+#else
+  return 2;
+#endif
+}
+
+static void
+report_part_progress (gchar * msg)
+{
+  if (Denemo.non_interactive)
+    g_print ("%s", msg);
+  else
+    console_output (msg);
+  g_free (msg);
+}
+
+static void
+finish_part_jobs (void)
+{
+  progressbar_stop ();
+  g_queue_free (waiting_parts);
+  waiting_parts = NULL;
+  if (parts_cancelled)
+    report_part_progress (g_strdup_printf (_("Typesetting parts cancelled, %d of %d typeset\n"), parts_done - parts_failed, parts_total));
+  else if (parts_failed)
+    {
+      report_part_progress (g_strdup_printf (_("%d of %d parts could not be typeset\n"), parts_failed, parts_total));
+      if (!Denemo.non_interactive)
+        warningdialog (_("Some parts could not be typeset, see the LilyPond errors window"));
+    }
+  else
+    report_part_progress (g_strdup_printf (_("All %d parts typeset\n"), parts_total));
+}
+
+static void start_part_jobs (void);
+
+static void
+part_job_finished (GPid pid, gint status, PartJob * job)
+{
+  gchar *pdf = g_strconcat (job->outbase, ".pdf", NULL);
+  g_spawn_close_pid (pid);
+  running_parts = g_list_remove (running_parts, job);
+  parts_done++;
+  if (status || !g_file_test (pdf, G_FILE_TEST_EXISTS))
+    {
+      parts_failed++;
+      if (!parts_cancelled)
+        report_part_progress (g_strdup_printf (_("Typesetting %s failed\n"), job->lilyfile));
+    }
+  else
+    report_part_progress (g_strdup_printf (_("Typeset part %d of %d: %s\n"), parts_done, parts_total, pdf));
+  g_free (pdf);
+  free_part_job (job);
+  start_part_jobs ();
+}
+
+static gboolean
+launch_part_job (PartJob * job)
+{
+  GError *err = NULL;
+  gchar *arguments[] = {
+    Denemo.prefs.lilypath->str,
+    "--loglevel=WARN",
+    "-dno-point-and-click",
+    "--pdf",
+    local_include,
+    include,
+    "-o",
+    job->outbase,
+    job->lilyfile,
+    NULL
+  };
+  if (!g_spawn_async (locateprintdir (), arguments, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_STDOUT_TO_DEV_NULL, NULL, NULL, &job->pid, &err))
+    {
+      g_warning ("Error launching lilypond %s for %s: %s", arguments[0], job->lilyfile, err->message);
+      g_error_free (err);
+      return FALSE;
+    }
+  running_parts = g_list_prepend (running_parts, job);
+  g_child_watch_add (job->pid, (GChildWatchFunc) part_job_finished, job);
+  return TRUE;
+}
+
+static void
+start_part_jobs (void)
+{
+  while (!g_queue_is_empty (waiting_parts) && ((gint) g_list_length (running_parts) < max_part_jobs ()))
+    {
+      PartJob *job = (PartJob *) g_queue_pop_head (waiting_parts);
+      if (!launch_part_job (job))
+        {
+          parts_done++;
+          parts_failed++;
+          free_part_job (job);
+        }
+    }
+  if (running_parts == NULL)
+    finish_part_jobs ();
+}
+
+static gboolean
+cancel_part_jobs (void)
+{
+  GList *g;
+  if (waiting_parts == NULL)
+    return TRUE;
+  parts_cancelled = TRUE;
+  while (!g_queue_is_empty (waiting_parts))
+    {
+      free_part_job ((PartJob *) g_queue_pop_head (waiting_parts));
+      parts_done++;
+      parts_failed++;
+    }
+  for (g = running_parts; g; g = g->next)
+    kill_process (((PartJob *) g->data)->pid);
+  if (running_parts == NULL)
+    finish_part_jobs ();
+  return TRUE;
+}
+
+/* typeset each part of the score, all movements, to filename_partname.pdf running several LilyPond processes at once.
+ * Returns FALSE if the parts could not be started. When non-interactive returns when all are done.
+ */
+gboolean
+export_parts_pdf (gchar * filename, DenemoProject * gui)
+{
+  GList *lilyfiles, *g;
+  if (waiting_parts)
+    {
+      warningdialog (_("Already typesetting parts"));
+      return FALSE;
+    }
+  lilyfiles = export_lilypond_part_files (filename, gui, TRUE);
+  if (lilyfiles == NULL)
+    return FALSE;
+  waiting_parts = g_queue_new ();
+  parts_total = g_list_length (lilyfiles);
+  parts_done = parts_failed = 0;
+  parts_cancelled = FALSE;
+  for (g = lilyfiles; g; g = g->next)
+    {
+      PartJob *job = (PartJob *) g_malloc0 (sizeof (PartJob));
+      job->lilyfile = (gchar *) g->data;
+      job->outbase = g_strndup (job->lilyfile, strlen (job->lilyfile) - strlen (".ly"));
+      g_queue_push_tail (waiting_parts, job);
+    }
+  g_list_free (lilyfiles);
+  report_part_progress (g_strdup_printf (_("Typesetting %d parts, %d at a time\n"), parts_total, max_part_jobs ()));
+  progressbar (_("Typesetting Parts"), cancel_part_jobs);
+  start_part_jobs ();
+  if (Denemo.non_interactive)
+    while (waiting_parts)
+      g_main_context_iteration (NULL, TRUE);
+  return TRUE;
+}
+
 /* callback to print current part (staff) of score */
 void
 printpart_cb (G_GNUC_UNUSED DenemoAction * action, G_GNUC_UNUSED DenemoScriptParam * param)
@@ -1065,7 +1764,7 @@ printpart_cb (G_GNUC_UNUSED DenemoAction * action, G_GNUC_UNUSED DenemoScriptPar
     create_pdf (TRUE, TRUE);
   else
     create_pdf (TRUE, FALSE);
-  g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (TRUE));
+  watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (TRUE));
 #endif
 }
 
@@ -1078,7 +1777,7 @@ printselection_cb (G_GNUC_UNUSED DenemoAction * action, G_GNUC_UNUSED DenemoScri
   if (Denemo.project->movement->markstaffnum) {
     present_print_view_window();
     create_pdf (FALSE, FALSE);
-    g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (TRUE));
+    watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (TRUE));
   }
   else
     warningdialog (_("No selection to print"));
@@ -124,16 +124,23 @@ gchar *get_lily_version_string (void);
 gchar *get_lilypond_include_dir (void);
 int check_lily_version (gchar * version);
 void export_pdf (gchar * filename, DenemoProject * gui);
+gboolean export_parts_pdf (gchar * filename, DenemoProject * gui);
 void generate_pdf_from_lily_file (gchar *lilyfile, gchar *outfile);
 void export_png (gchar * filename, GChildWatchFunc finish, DenemoProject * gui);
 void printpng_finished (GPid pid, gint status, GList * filelist);
 gboolean create_thumbnail (gboolean async, gchar* thumbnail_path);
+gboolean queue_thumbnail (gchar * filename, gchar * thumbnail_path);
+void queue_directory_thumbnails (gchar * dirname);
 gchar *large_thumbnail_name (gchar * filepath);
 gboolean stop_lilypond ();
 void process_lilypond_errors (gchar * filename);
 gchar *get_printfile_pathbasename (void);
 void create_pdf (gboolean part_only, gboolean all_movements);
+void watch_typeset (GChildWatchFunc finish, gpointer data);
+void watch_typeset_full (GChildWatchFunc finish, gpointer data, GDestroyNotify destroy);
 void show_print_view (DenemoAction * action, DenemoScriptParam * param);
 void create_svg (gboolean part_only, gboolean all_movements);
 void create_pdf_for_lilypond (gchar *lilypond);
+gboolean typeset_lilypond_text (gchar * lilypond, gchar * basename, GChildWatchFunc finish, gpointer data, GDestroyNotify destroy);
+gboolean join_pdfs_for_print_view (GList * pdfs, GChildWatchFunc finish, gpointer data);
 #endif /*PRINT_H */
@@ -101,7 +101,8 @@ markupview_finished (G_GNUC_UNUSED GPid pid, gint status, gboolean print)
       g_warning ("Lilypond did not end successfully: %s", err->message);
   }
 #endif
-  g_spawn_close_pid (Denemo.printstatus->printpid);
+  if (Denemo.printstatus->printpid != GPID_NONE)
+    g_spawn_close_pid (Denemo.printstatus->printpid);   //none when the output came from the typeset cache
   //g_debug("background %d\n", Denemo.printstatus->background);
   if (Denemo.printstatus->background == STATE_NONE)
     {
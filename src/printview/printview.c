@@ -638,7 +638,8 @@ printview_finished (G_GNUC_UNUSED GPid pid, gint status, gboolean print)
       g_warning ("Lilypond did not end successfully: %s", err->message);
   }
 #endif
-  g_spawn_close_pid (Denemo.printstatus->printpid);
+  if (Denemo.printstatus->printpid != GPID_NONE)
+    g_spawn_close_pid (Denemo.printstatus->printpid);   //none when the output came from the typeset cache
   //g_debug("background %d\n", Denemo.printstatus->background);
   if (Denemo.printstatus->background == STATE_NONE)
     {
@@ -757,7 +758,7 @@ refresh_print_view (G_GNUC_UNUSED gboolean interactive)
 {
   start_busy_cursor ();
   if (typeset (FALSE))
-    g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (FALSE));
+    watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (FALSE));
   else
     start_normal_cursor ();
 }
@@ -770,7 +771,7 @@ print_from_print_view (gboolean all_movements)
   start_busy_cursor ();
   if (all_movements ? typeset (FALSE) : typeset_movement (FALSE))
     {
-      g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (TRUE));
+      watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (TRUE));
     }
   else
     {
@@ -807,8 +808,6 @@ static void
 thumb_finished (gchar * thumbname)
 {
   GError *err = NULL;
-  g_spawn_close_pid (Denemo.printstatus->printpid);
-  Denemo.printstatus->printpid = GPID_NONE;
   gchar *printname = get_thumb_printname ();
   gchar *printpng = g_strconcat (printname, ".png", NULL);
 
@@ -857,8 +856,6 @@ thumb_finished (gchar * thumbname)
       g_free (thumbpathL);
     }
   g_free (printname);
-  Denemo.printstatus->printpid = GPID_NONE;
-  progressbar_stop ();
 }
 
 // large_thumbnail_name takes a full path name to a .denemo file and returns the full path to the large thumbnail of that .denemo file. Caller must g_free the returned string
@@ -871,15 +868,143 @@ large_thumbnail_name (gchar * filepath)
   return g_build_filename (get_thumb_directory (), ret, NULL);
 }
 
+typedef struct ThumbnailJob
+{
+  gchar *filename;              //the saved score
+  gchar *thumbnail_path;        //where to put the thumbnail, NULL for the standard places
+} ThumbnailJob;
+
+static GQueue *thumbnail_queue = NULL;  //thumbnails to make, the head one is being made
+static GPid thumbnail_pid = GPID_NONE;  //the Denemo making the thumbnail at the head of the queue
+
+static void start_next_thumbnail (void);
+
 static void
-thumbnail_finished (GPid pid, gint status, gpointer data)
+free_thumbnail_job (ThumbnailJob * job)
+{
+  g_free (job->filename);
+  g_free (job->thumbnail_path);
+  g_free (job);
+}
+
+static gboolean
+thumbnail_is_current (gchar * filename, gchar * thumbpath)
 {
+  struct stat score, thumb;
+  return (g_stat (thumbpath, &thumb) == 0) && (g_stat (filename, &score) == 0) && (thumb.st_mtime >= score.st_mtime);
+}
+
+static void
+thumbnail_finished (GPid pid, gint status, G_GNUC_UNUSED gpointer data)
+{
+  ThumbnailJob *job = (ThumbnailJob *) g_queue_pop_head (thumbnail_queue);
+  g_spawn_close_pid (pid);
+  thumbnail_pid = GPID_NONE;
   if (status)
-    g_warning ("Thumbnailer: Lilyond did not end successfully");
+    g_warning ("Thumbnailer: could not make a thumbnail for %s", job->filename);
+  free_thumbnail_job (job);
+  start_next_thumbnail ();
+}
+
+/* the path as the text of a Scheme string literal, with its quotes and backslashes (as in Windows paths) escaped */
+static gchar *
+scheme_quoted_path (gchar * path)
+{
+  GString *out = g_string_new ("");
+  gchar *c;
+  for (c = path; *c; c++)
+    {
+      if ((*c == '"') || (*c == '\\'))
+        g_string_append_c (out, '\\');
+      g_string_append_c (out, *c);
+    }
+  return g_string_free (out, FALSE);
+}
+
+static void
+start_next_thumbnail (void)
+{
+  while ((thumbnail_pid == GPID_NONE) && !g_queue_is_empty (thumbnail_queue))
+    {
+      ThumbnailJob *job = (ThumbnailJob *) g_queue_peek_head (thumbnail_queue);
+      GError *err = NULL;
+      gchar *quoted = job->thumbnail_path ? scheme_quoted_path (job->thumbnail_path) : NULL;
+      gchar *script = quoted ? g_strdup_printf ("(d-CreateThumbnail #f \"%s\")(d-Exit)", quoted) : g_strdup ("(d-CreateThumbnail #f)(d-Exit)");
+      g_free (quoted);
+      gchar *arguments[] = {
+        g_build_filename (get_system_bin_dir (), "denemo", NULL),
+        "-n", "-a", script,
+        job->filename,
+        NULL
+      };
+      if (g_spawn_async (NULL, arguments, NULL, G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, &thumbnail_pid, &err))
+        {
+          g_info ("Launched thumbnail subprocess for %s", job->filename);
+          g_child_watch_add (thumbnail_pid, thumbnail_finished, NULL);
+        }
+      else
+        {
+          g_critical ("An error happened during thumbnail generation: %s", err->message);
+          g_error_free (err);
+          thumbnail_pid = GPID_NONE;
+          free_thumbnail_job ((ThumbnailJob *) g_queue_pop_head (thumbnail_queue));
+        }
+      g_free (arguments[0]);
+      g_free (script);
+    }
+}
+
+/***
+ *  Queue the making of a thumbnail for the saved score filename, unless it already has an up-to-date one.
+ *  Thumbnails are made one at a time by a separate Denemo reading the file, so the score being edited is
+ *  untouched and typesetting is not held up. thumbnail_path is where to put it, NULL for the standard places.
+ */
+gboolean
+queue_thumbnail (gchar * filename, gchar * thumbnail_path)
+{
+  gchar *target = thumbnail_path ? g_strdup (thumbnail_path) : large_thumbnail_name (filename);
+  gboolean current = thumbnail_is_current (filename, target);
+  GList *g;
+  g_free (target);
+  if (current || Denemo.non_interactive)
+    return FALSE;
+  if (thumbnail_queue == NULL)
+    thumbnail_queue = g_queue_new ();
+  for (g = thumbnail_queue->head; g; g = g->next)
+    {
+      ThumbnailJob *job = (ThumbnailJob *) g->data;
+      if (!strcmp (job->filename, filename) && !g_strcmp0 (job->thumbnail_path, thumbnail_path))
+        return TRUE;
+    }
+  ThumbnailJob *job = (ThumbnailJob *) g_malloc (sizeof (ThumbnailJob));
+  job->filename = g_strdup (filename);
+  job->thumbnail_path = g_strdup (thumbnail_path);
+  g_queue_push_tail (thumbnail_queue, job);
+  start_next_thumbnail ();
+  return TRUE;
+}
+
+/* queue thumbnails for the Denemo scores in the directory dirname that lack up-to-date ones */
+void
+queue_directory_thumbnails (gchar * dirname)
+{
+  const gchar *name;
+  GDir *dir = dirname ? g_dir_open (dirname, 0, NULL) : NULL;
+  if (dir == NULL)
+    return;
+  while ((name = g_dir_read_name (dir)))
+    if (g_str_has_suffix (name, ".denemo"))
+      {
+        gchar *filename = g_build_filename (dirname, name, NULL);
+        queue_thumbnail (filename, NULL);
+        g_free (filename);
+      }
+  g_dir_close (dir);
 }
 
 /***
- *  Create a thumbnail for Denemo.project if needed
+ *  Create a thumbnail for Denemo.project if needed, with async the thumbnail is made from the saved file
+ *  via queue_thumbnail () otherwise the current score is typeset, waiting for the result.
  */
 gboolean
 create_thumbnail (gboolean async, gchar * thumbnail_path)
@@ -888,16 +1013,20 @@ create_thumbnail (gboolean async, gchar * thumbnail_path)
   return FALSE;
 #endif
 
-  GError *err = NULL;
   gchar *thumbpathN = NULL;
   gchar *thumbname = NULL;
 
-  if (Denemo.printstatus->printpid != GPID_NONE)
-    return FALSE;
-
   if (!Denemo.project->filename->len)
     return TRUE;
 
+  if (async)
+    {
+      gchar *path = (thumbnail_path && !g_path_is_absolute (thumbnail_path)) ? g_build_filename (g_get_current_dir (), thumbnail_path, NULL) : g_strdup (thumbnail_path);
+      queue_thumbnail (Denemo.project->filename->str, path);
+      g_free (path);
+      return TRUE;
+    }
+
   if (thumbnail_path)
     {
       thumbpathN = thumbnail_path;
@@ -932,16 +1061,7 @@ create_thumbnail (gboolean async, gchar * thumbnail_path)
       thumbpathN = g_build_filename (thumbnailsdirN, thumbname, NULL);
     }
 
-  //check if thumbnail is newer than file
-  struct stat thebuf;
-  g_stat (Denemo.project->filename->str, &thebuf);
-  unsigned mtime = thebuf.st_mtime;
-
-  thebuf.st_mtime = 0;
-  g_stat (thumbpathN, &thebuf);
-  unsigned mtime_thumb = thebuf.st_mtime;
-
-  if (mtime_thumb >= mtime)
+  if (thumbnail_is_current (Denemo.project->filename->str, thumbpathN))
     {
       g_debug ("Do not update thumbnail %s", thumbpathN);
       return FALSE;
@@ -951,6 +1071,9 @@ create_thumbnail (gboolean async, gchar * thumbnail_path)
 
   gint saved = g_list_index (Denemo.project->movements, Denemo.project->movement);
   Denemo.project->movement = Denemo.project->movements->data;   //Thumbnail is from first movement
+  DenemoSelection selection = Denemo.project->movement->selection;
+  gint markstaffnum = Denemo.project->movement->markstaffnum;
+  gboolean excerpt = Denemo.project->lilycontrol.excerpt;
   //set selection to thumbnailselection, if not set, to the selection, if not set to first three measures of staff 1
   if (Denemo.project->thumbnail.firststaffmarked)
     memcpy (&Denemo.project->movement->selection, &Denemo.project->thumbnail, sizeof (DenemoSelection));
@@ -970,37 +1093,13 @@ create_thumbnail (gboolean async, gchar * thumbnail_path)
   gchar *printname = get_thumb_printname ();
   Denemo.project->lilycontrol.excerpt = TRUE;
 
-  if (async)
-    {
-      gchar *arguments[] = {
-        g_build_filename (get_system_bin_dir (), "denemo", NULL),
-        "-n", "-a", "(d-CreateThumbnail #f)(d-Exit)",
-        Denemo.project->filename->str,
-        NULL
-      };
-      GPid pid;
-      gboolean success = g_spawn_async_with_pipes (NULL,        /* any dir */
-                                                   arguments, NULL,     /* env */
-                                                   G_SPAWN_SEARCH_PATH, NULL,   /* child setup func */
-                                                   NULL,        /* user data */
-                                                   &pid,        /* pid */
-                                                   NULL,        /* stdin */
-                                                   NULL,        /* stdout */
-                                                   NULL,        /* stderr */
-                                                   &err);
-      if (success)
-        g_info ("Launched thumbnail subprocess");
-      else
-        g_critical ("An error happened during thumbnail generation: %s", err->message);
-      g_child_watch_add (pid, thumbnail_finished, NULL);
-    }
-  else
-    {
-      export_png (printname, NULL, Denemo.project);
-      thumb_finished (thumbname);
-    }
+  export_png (printname, NULL, Denemo.project);
+  thumb_finished (thumbname);
 
   g_free (printname);
+  Denemo.project->lilycontrol.excerpt = excerpt;
+  Denemo.project->movement->markstaffnum = markstaffnum;
+  Denemo.project->movement->selection = selection;
   Denemo.project->movement = g_list_nth_data (Denemo.project->movements, saved);
   if (Denemo.project->movement == NULL)
     Denemo.project->movement = Denemo.project->movements->data;
@@ -1272,7 +1371,7 @@ create_all_pdf (void)
 {
   start_busy_cursor ();
   create_pdf (FALSE, TRUE);
-  g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (FALSE));
+  watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (FALSE));
 }
 
 static void
@@ -1281,7 +1380,7 @@ create_full_score_pdf (void)
   start_busy_cursor ();
   create_default_scoreblock ();
   create_pdf (FALSE, TRUE);
-  g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (FALSE));
+  watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (FALSE));
 }
 
 static void
@@ -1362,7 +1461,7 @@ create_movement_pdf (void)
   return_on_windows_if_printing;
   start_busy_cursor ();
   create_pdf (FALSE, FALSE);
-  g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (FALSE));
+  watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (FALSE));
 }
 
 static void
@@ -1371,7 +1470,7 @@ create_part_pdf (void)
   return_on_windows_if_printing;
   start_busy_cursor ();
   create_pdf (TRUE, TRUE);
-  g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (FALSE));
+  watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (FALSE));
 }
 
 static gint
@@ -2291,7 +2390,7 @@ typeset_control (gpointer data)
         }
       g_string_assign (last_script, data);
       last_data = NULL;
-      g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (FALSE));
+      watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (FALSE));
       if (Denemo.printstatus->background == STATE_ON)
         {
           restore_selection (Denemo.project->movement);
@@ -2312,7 +2411,7 @@ typeset_control (gpointer data)
 
           start_busy_cursor ();
           call_out_to_guile (last_script->str);
-          g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) printview_finished, (gpointer) (FALSE));
+          watch_typeset ((GChildWatchFunc) printview_finished, (gpointer) (FALSE));
 
           Denemo.project->movement->markstaffnum = markstaff;
           goto END;
@@ -2437,41 +2536,336 @@ typeset_current_movement (void)
 {
   typeset_control (create_movement_pdf);
 }
+/* Typesetting by movement
+ * In continuous typesetting of all the movements each movement is typeset by a separate LilyPond run
+ * and the pdfs are joined with ghostscript, so that with the typeset cache only movements whose text
+ * has changed are re-run. Each run uses the LilyPond text for the whole score with the text belonging
+ * to the other movements removed except for its newlines, so that line numbers (and so point-and-click)
+ * refer to the text in the LilyPond window. Page numbering continues from the previous movement.
+ */
+typedef struct MovementTypeset
+{
+  gchar *text;                  //the LilyPond text for all the movements
+  gint length;
+  gint paper;                   //offset in text of the line where the paper settings for a later movement are put
+  GArray *ranges;               //triples movement, start, end byte offsets of the text belonging to just one movement, in order
+  gint movements;
+  gint current;                 //movement being typeset, from 1
+  gint pages;                   //pages typeset so far
+  GList *pdfs;                  //the pdf for each movement typeset so far
+  gboolean joining;             //the pdfs are being joined
+} MovementTypeset;
+
+static MovementTypeset *movement_typeset = NULL;
+static GPid retypeset_pid = GPID_NONE;  //the LilyPond started by the last continuous re-typeset
+
+static void
+free_movement_typeset (MovementTypeset * mt)
+{
+  g_free (mt->text);
+  g_array_free (mt->ranges, TRUE);
+  g_list_free_full (mt->pdfs, g_free);
+  g_free (mt);
+}
+
+/* append the ranges of the score layout belonging to each movement, that is from the end of the previous movement to the end of its score block */
+static gboolean
+get_scoreblock_ranges (MovementTypeset * mt)
+{
+  gint first = -1, starts = 0, movement = 0;
+  gchar *line, *next;
+  for (line = mt->text; line < mt->text + mt->length; line = next)
+    {
+      gchar *newline = strchr (line, '\n');
+      gint end = newline ? newline - mt->text : mt->length;     //the end of the line, before its newline
+      next = newline ? newline + 1 : mt->text + mt->length;
+      if (g_strstr_len (line, end - (line - mt->text), "%Start of Movement"))
+        {
+          starts++;
+          if (first < 0)
+            first = line - mt->text;
+        }
+      if (g_strstr_len (line, end - (line - mt->text), "%End of Movement"))
+        {
+          gint triple[3] = { ++movement, first, end };
+          if (first < 0)
+            return FALSE;
+          g_array_append_vals (mt->ranges, triple, 3);
+          first = next - mt->text;
+        }
+    }
+  return (starts == mt->movements) && (movement == mt->movements);
+}
+
+static gint
+compare_movement_ranges (const gint * a, const gint * b)
+{
+  return a[1] - b[1];
+}
+
+/* put the ranges of mt in the order they occur in the text, returns FALSE if any overlap
+ * or if the line for the paper settings, which belongs to the prolog, is in one */
+static gboolean
+sort_movement_ranges (MovementTypeset * mt)
+{
+  guint i;
+  g_qsort_with_data (mt->ranges->data, mt->ranges->len / 3, 3 * sizeof (gint), (GCompareDataFunc) compare_movement_ranges, NULL);
+  for (i = 0; i < mt->ranges->len; i += 3)
+    {
+      if ((i > 0) && (g_array_index (mt->ranges, gint, i + 1) < g_array_index (mt->ranges, gint, i - 1)))
+        return FALSE;
+      if ((mt->paper >= g_array_index (mt->ranges, gint, i + 1)) && (mt->paper < g_array_index (mt->ranges, gint, i + 2)))
+        return FALSE;
+    }
+  return TRUE;
+}
+
+/* append the text of mt from start to end, putting the paper settings for mt->current in their place if they fall in it */
+static void
+append_movement_text (GString * text, MovementTypeset * mt, gint start, gint end)
+{
+  if ((mt->current > 1) && (mt->paper >= start) && (mt->paper < end))
+    {
+      g_string_append_len (text, mt->text + start, mt->paper - start);
+      g_string_append_printf (text, "\\paper { first-page-number = #%d print-first-page-number = ##t bookTitleMarkup = ##f } ", mt->pages + 1);
+      start = mt->paper;
+    }
+  g_string_append_len (text, mt->text + start, end - start);
+}
+
+/* the LilyPond text for typesetting movement mt->current alone */
+static gchar *
+movement_typeset_text (MovementTypeset * mt)
+{
+  GString *text = g_string_sized_new (mt->length + 128);
+  gint done = 0;                //bytes of mt->text dealt with
+  guint i;
+  for (i = 0; i < mt->ranges->len; i += 3)
+    {
+      gint start = g_array_index (mt->ranges, gint, i + 1);
+      gint end = g_array_index (mt->ranges, gint, i + 2);
+      gchar *c;
+      if (g_array_index (mt->ranges, gint, i) == mt->current)
+        continue;
+      append_movement_text (text, mt, done, start);
+      for (c = mt->text + start; c < mt->text + end; c++)
+        if (*c == '\n')
+          g_string_append_c (text, '\n');    //keep the line numbers of the text that follows
+      done = end;
+    }
+  append_movement_text (text, mt, done, mt->length);
+  return g_string_free (text, FALSE);
+}
+
+static gint
+count_pdf_pages (gchar * filename)
+{
+  gint pages = 0;
+  GError *err = NULL;
+  GFile *file;
+  gchar *uri;
+  EvDocument *doc;
+  if (!g_file_test (filename, G_FILE_TEST_EXISTS))
+    return 0;
+  file = g_file_new_for_path (filename);
+  uri = g_file_get_uri (file);
+  g_object_unref (file);
+  doc = ev_document_factory_get_document (uri, &err);
+  if (err)
+    g_error_free (err);
+  else if (doc)
+    {
+      pages = ev_document_get_n_pages (doc);
+      g_object_unref (doc);
+    }
+  g_free (uri);
+  return pages;
+}
+
+static void
+typeset_all_movements_together (void)
+{
+  gint background = Denemo.printstatus->background;
+  Denemo.printstatus->background = STATE_ON;
+  typeset_control ("(disp \"Typesetting all movements together\")(d-PrintView)");
+  Denemo.printstatus->background = background;
+}
+
+static void
+movements_joined (GPid pid, gint status, MovementTypeset * mt)
+{
+  free_movement_typeset (mt);
+  if (mt != movement_typeset)
+    return;                     //abandoned, the joining process was killed
+  movement_typeset = NULL;
+  printview_finished (pid, status, FALSE);
+}
+
+/* drop a typeset by movement in progress, its LilyPond or ghostscript process is left for stop_lilypond () */
+static void
+abandon_movement_typeset (void)
+{
+  MovementTypeset *mt = movement_typeset;
+  movement_typeset = NULL;
+  if (mt && !mt->joining)       //otherwise movements_joined () frees it
+    free_movement_typeset (mt);
+}
+
+static gboolean typeset_next_movement (void);
+
+static void
+movement_typeset_finished (GPid pid, gint status, gchar * pdf)
+{
+  MovementTypeset *mt = movement_typeset;
+  gint pages;
+  if (mt == NULL)
+    {                           //abandoned by retypeset ()
+      g_free (pdf);
+      return;
+    }
+  pages = count_pdf_pages (pdf);
+  if (pid != GPID_NONE)
+    g_spawn_close_pid (pid);
+  Denemo.printstatus->printpid = GPID_NONE;
+  if (pages > 0)
+    {
+      mt->pages += pages;
+      mt->pdfs = g_list_append (mt->pdfs, pdf);
+      if (++mt->current <= mt->movements)
+        {
+          if (typeset_next_movement ())
+            return;
+        }
+      else
+        {
+          mt->joining = TRUE;
+          if (join_pdfs_for_print_view (mt->pdfs, (GChildWatchFunc) movements_joined, mt))
+            return;
+        }
+    }
+  else
+    g_free (pdf);
+  //LilyPond errors or a missing tool - typeset the whole score in one run, which reports any errors
+  free_movement_typeset (mt);
+  movement_typeset = NULL;
+  typeset_all_movements_together ();
+}
+
+static gboolean
+typeset_next_movement (void)
+{
+  MovementTypeset *mt = movement_typeset;
+  gchar *text = movement_typeset_text (mt);
+  gchar *name = g_strdup_printf ("denemomovement%d", mt->current);
+  gchar *basename = g_build_filename (locateprintdir (), name, NULL);
+  gchar *pdf = g_strconcat (basename, ".pdf", NULL);
+  gboolean success = typeset_lilypond_text (text, basename, (GChildWatchFunc) movement_typeset_finished, pdf, g_free);
+  if (!success)
+    g_free (pdf);
+  g_free (text);
+  g_free (name);
+  g_free (basename);
+  return success;
+}
+
+/* start typesetting all the movements by movement, returns FALSE if the score cannot be typeset that way */
+static gboolean
+typeset_by_movement (void)
+{
+  DenemoProject *gui = Denemo.project;
+  gint movements = g_list_length (gui->movements);
+  gchar *gs, *text, *lilyfile;
+  gsize length;
+  MovementTypeset *mt;
+  if ((movements < 2) || (Denemo.prefs.typeset_cache_size <= 0) || (movement_typeset != NULL) || (Denemo.prefs.ghostscript->len == 0))
+    return FALSE;
+  gs = g_find_program_in_path (Denemo.prefs.ghostscript->str);
+  if (gs == NULL)
+    return FALSE;
+  g_free (gs);
+  gint markstaff = gui->movement->markstaffnum;
+  gui->movement->markstaffnum = 0;
+  get_wysiwyg_info ()->stage = STAGE_NONE;
+  Denemo.printstatus->invalid = 0;
+  g_free (Denemo.printstatus->error_file);
+  Denemo.printstatus->error_file = NULL;
+  lilyfile = g_build_filename (locateprintdir (), "denemomovements.ly", NULL);
+  exportlilypond (lilyfile, gui, TRUE);
+  gui->movement->markstaffnum = markstaff;
+  mt = (MovementTypeset *) g_malloc0 (sizeof (MovementTypeset));
+  mt->ranges = g_array_new (FALSE, FALSE, sizeof (gint));
+  mt->movements = movements;
+  mt->current = 1;
+  if (g_file_get_contents (lilyfile, &text, &length, NULL))
+    {
+      gchar *paper = strstr (text, "\n" LILYPOND_MUSIC_FOLLOWS "\n");
+      mt->text = text;
+      mt->length = length;
+      mt->paper = paper ? (paper + 1 - text) : -1;
+    }
+  g_free (lilyfile);
+  if (mt->text && (mt->paper >= 0) && get_music_section_ranges (mt->ranges) && get_scoreblock_ranges (mt) && sort_movement_ranges (mt))
+    {
+      movement_typeset = mt;
+      if (typeset_next_movement ())
+        return TRUE;
+      movement_typeset = NULL;
+    }
+  free_movement_typeset (mt);
+  return FALSE;
+}
+
+/* Called periodically during continuous typesetting. A typeset is started once the score has been
+ * left unchanged for one period; if an earlier re-typeset is still running for an older state of the
+ * score it is killed first, and its output is never shown (see watch_typeset ()).
+ */
 static gboolean retypeset (void)
 {
   static gint firstmeasure, lastmeasure, firststaff, laststaff, movementnum;
+  static gint seen_changecount = -1;    //changecount at the previous call, to wait for a pause in editing
   DenemoMovement *si = Denemo.project->movement;
+  gboolean edited, needed;
   if (si==NULL)
 	return TRUE;
-  if ((Denemo.printstatus->printpid == GPID_NONE) && (gtk_widget_get_visible (gtk_widget_get_toplevel (Denemo.printarea))))
+  edited = (seen_changecount != Denemo.project->changecount);
+  seen_changecount = Denemo.project->changecount;
+  if ((edited && Denemo.prefs.typesetrefresh) || !gtk_widget_get_visible (gtk_widget_get_toplevel (Denemo.printarea)))
+    return TRUE;
+  if ((Denemo.printstatus->printpid != GPID_NONE) && (Denemo.printstatus->printpid != retypeset_pid) && (movement_typeset == NULL))
+    return TRUE;                //a typeset not started here is running
+  if (Denemo.printstatus->typeset_type == TYPESET_ALL_MOVEMENTS)
+    needed = (changecount != Denemo.project->changecount) || (Denemo.project->lilysync != Denemo.project->changecount);
+  else
+    needed = (changecount != Denemo.project->changecount) || (Denemo.project->lilysync != Denemo.project->changecount) || (si->currentmovementnum != movementnum) || ((Denemo.printstatus->typeset_type == TYPESET_EXCERPT) && (si->currentmeasurenum < firstmeasure || si->currentmeasurenum > lastmeasure || si->currentstaffnum < firststaff || si->currentstaffnum > laststaff));
+  if (!needed)
+    return TRUE;
+  if ((Denemo.printstatus->printpid != GPID_NONE) || movement_typeset)
+    {                           //supersede the stale typeset
+      abandon_movement_typeset ();
+      stop_lilypond ();
+    }
+  Denemo.printstatus->background = STATE_ON;
+  if (Denemo.printstatus->typeset_type == TYPESET_ALL_MOVEMENTS)
     {
-      if (Denemo.printstatus->typeset_type == TYPESET_ALL_MOVEMENTS)
-        {
-          if ((changecount != Denemo.project->changecount) || (Denemo.project->lilysync != Denemo.project->changecount))
-            {
-              Denemo.printstatus->background = STATE_ON;
-              typeset_control ("(d-Info \"This is called when hitting the refresh button while in continuous re-typeset\")(d-PrintView)");
-              Denemo.printstatus->background = STATE_OFF;
-              changecount = Denemo.project->changecount;
-            }
-        }
-      else if ((changecount != Denemo.project->changecount) || (Denemo.project->lilysync != Denemo.project->changecount) || (si->currentmovementnum != movementnum) || ((Denemo.printstatus->typeset_type == TYPESET_EXCERPT) && (si->currentmeasurenum < firstmeasure || si->currentmeasurenum > lastmeasure || si->currentstaffnum < firststaff || si->currentstaffnum > laststaff)))
-        {
-          firstmeasure = si->currentmeasurenum - Denemo.printstatus->first_measure;
-          if (firstmeasure < 0)
-            firstmeasure = 0;
-          lastmeasure = si->currentmeasurenum + Denemo.printstatus->last_measure;
-          firststaff = si->currentstaffnum - Denemo.printstatus->first_staff;
-          if (firststaff < 0)
-            firststaff = 0;
-          laststaff = si->currentstaffnum + Denemo.printstatus->last_staff;
-          movementnum = si->currentmovementnum;
-          Denemo.printstatus->background = STATE_ON;
-          typeset_control ("(disp \"This is called when hitting the refresh button while in continuous re-typeset\")(d-PrintView)");
-          Denemo.printstatus->background = STATE_OFF;
-          changecount = Denemo.project->changecount;
-        }
+      if (!typeset_by_movement ())
+        typeset_control ("(d-Info \"This is called when hitting the refresh button while in continuous re-typeset\")(d-PrintView)");
     }
+  else
+    {
+      firstmeasure = si->currentmeasurenum - Denemo.printstatus->first_measure;
+      if (firstmeasure < 0)
+        firstmeasure = 0;
+      lastmeasure = si->currentmeasurenum + Denemo.printstatus->last_measure;
+      firststaff = si->currentstaffnum - Denemo.printstatus->first_staff;
+      if (firststaff < 0)
+        firststaff = 0;
+      laststaff = si->currentstaffnum + Denemo.printstatus->last_staff;
+      movementnum = si->currentmovementnum;
+      typeset_control ("(disp \"This is called when hitting the refresh button while in continuous re-typeset\")(d-PrintView)");
+    }
+  Denemo.printstatus->background = STATE_OFF;
+  retypeset_pid = Denemo.printstatus->printpid;
+  changecount = Denemo.project->changecount;
   return TRUE;                  //continue
 }
 
@@ -730,7 +730,8 @@ playbackview_finished (G_GNUC_UNUSED GPid pid, G_GNUC_UNUSED gint status, gboole
 {
   progressbar_stop ();
   console_output (_("Done (Playback View)"));
-  g_spawn_close_pid (Denemo.printstatus->printpid);
+  if (Denemo.printstatus->printpid != GPID_NONE)
+    g_spawn_close_pid (Denemo.printstatus->printpid);   //none when the output came from the typeset cache
   //g_print ("background %d\n", Denemo.printstatus->background);
   if (Denemo.printstatus->background == STATE_NONE)
     {
@@ -867,7 +868,7 @@ static void remake_playback_view (gboolean part)
     set_continuous_typesetting (FALSE);
     create_svg (part, FALSE);//there is a typeset() function defined which does initialize_typesetting() ...
     //g_print ("Denemo.playbackview is at %p, Denemo at %p", Denemo.playbackview, &Denemo);
-    g_child_watch_add (Denemo.printstatus->printpid, (GChildWatchFunc) playbackview_finished, (gpointer) (FALSE));
+    watch_typeset ((GChildWatchFunc) playbackview_finished, (gpointer) (FALSE));
 }
 
 //returns TRUE if a re-build has been kicked off.
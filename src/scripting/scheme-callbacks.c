@@ -2116,6 +2116,19 @@ scheme_open_proofread_file (SCM optional)
   return SCM_BOOL_F;
 }
 
+SCM
+scheme_render_audio (SCM name, SCM stems)
+{
+  gchar *filename = NULL;
+  gboolean ret;
+  if (scm_is_string (name))
+    filename = scm_to_locale_string (name);
+  ret = render_audio (filename, scm_is_bool (stems) && scm_is_true (stems));
+  if (filename)
+    free (filename);
+  return SCM_BOOL (ret);
+}
+
 #ifdef DISABLE_AUBIO
 #else
 SCM
@@ -3859,6 +3872,426 @@ scheme_get_measure_number_offset (void)
 }
 
 
+/* Bulk access to the object model. These return (or take) whole measures,
+ * staffs or movements without moving the cursor, so that analysis scripts
+ * need not walk the score object by object.
+ * An object record is a vector
+ *   #(type start-tick duration-in-ticks baseduration numdots notes tags)
+ * where baseduration and numdots are #f for non-chords, notes is a list of note records
+ *   #(mid_c_offset enshift lilypond-name midi-key tags)
+ * and tags are lists of the tags of the directives attached. */
+
+static DenemoMovement *
+movement_for_scm (SCM movement)
+{
+  if (scm_is_integer (movement))
+    {
+      gint n = scm_to_int (movement);
+      if (n < 1)
+        return NULL;
+      if (Denemo.project->movements)
+        return (DenemoMovement *) g_list_nth_data (Denemo.project->movements, n - 1);
+      return (n == 1) ? Denemo.project->movement : NULL;
+    }
+  return Denemo.project->movement;
+}
+
+static staffnode *
+staffnode_for_scm (DenemoMovement * si, SCM staff)
+{
+  if (si == NULL)
+    return NULL;
+  if (scm_is_integer (staff))
+    {
+      gint n = scm_to_int (staff);
+      return (n < 1) ? NULL : g_list_nth (si->thescore, n - 1);
+    }
+  return si->currentstaff;
+}
+
+static measurenode *
+measurenode_for_scm (DenemoMovement * si, staffnode * staff, SCM measure)
+{
+  gint n;
+  if (staff == NULL)
+    return NULL;
+  n = scm_is_integer (measure) ? scm_to_int (measure) : si->currentmeasurenum;
+  return (n < 1) ? NULL : g_list_nth (((DenemoStaff *) staff->data)->themeasures, n - 1);
+}
+
+static SCM
+directive_tags_to_scm (GList * directives)
+{
+  SCM ret = SCM_EOL;
+  for (directives = g_list_last (directives); directives; directives = directives->prev)
+    {
+      DenemoDirective *directive = (DenemoDirective *) directives->data;
+      if (directive->tag)
+        ret = scm_cons (scm_from_locale_string (directive->tag->str), ret);
+    }
+  return ret;
+}
+
+static SCM
+note_record (note * thenote)
+{
+  SCM ret = scm_c_make_vector (5, SCM_BOOL_F);
+  gchar *name = mid_c_offsettolily (thenote->mid_c_offset, thenote->enshift);
+  scm_c_vector_set_x (ret, 0, scm_from_int (thenote->mid_c_offset));
+  scm_c_vector_set_x (ret, 1, scm_from_int (thenote->enshift));
+  scm_c_vector_set_x (ret, 2, scm_from_locale_string (name));
+  scm_c_vector_set_x (ret, 3, scm_from_int (dia_to_midinote (thenote->mid_c_offset) + thenote->enshift));
+  scm_c_vector_set_x (ret, 4, directive_tags_to_scm (thenote->directives));
+  g_free (name);
+  return ret;
+}
+
+static SCM
+object_record (DenemoObject * obj)
+{
+  SCM ret = scm_c_make_vector (7, SCM_BOOL_F);
+  SCM notes = SCM_EOL;
+  SCM tags = SCM_EOL;
+  scm_c_vector_set_x (ret, 0, scm_from_locale_string (DENEMO_OBJECT_TYPE_NAME (obj) ? DENEMO_OBJECT_TYPE_NAME (obj) : "None"));
+  scm_c_vector_set_x (ret, 1, scm_from_int (obj->starttick));
+  scm_c_vector_set_x (ret, 2, scm_from_int (obj->durinticks));
+  if (obj->type == CHORD)
+    {
+      chord *thechord = (chord *) obj->object;
+      GList *g;
+      scm_c_vector_set_x (ret, 3, scm_from_int (thechord->baseduration));
+      scm_c_vector_set_x (ret, 4, scm_from_int (thechord->numdots));
+      for (g = g_list_last (thechord->notes); g; g = g->prev)
+        notes = scm_cons (note_record ((note *) g->data), notes);
+      tags = directive_tags_to_scm (thechord->directives);
+    }
+  else if (obj->type == LILYDIRECTIVE)
+    {
+      DenemoDirective *directive = (DenemoDirective *) obj->object;
+      if (directive->tag)
+        tags = scm_list_1 (scm_from_locale_string (directive->tag->str));
+    }
+  scm_c_vector_set_x (ret, 5, notes);
+  scm_c_vector_set_x (ret, 6, tags);
+  return ret;
+}
+
+static SCM
+measure_records (measurenode * mnode)
+{
+  GList *objs = ((DenemoMeasure *) mnode->data)->objects;
+  SCM ret = scm_c_make_vector (g_list_length (objs), SCM_BOOL_F);
+  gint i;
+  for (i = 0; objs; objs = objs->next, i++)
+    scm_c_vector_set_x (ret, i, object_record ((DenemoObject *) objs->data));
+  return ret;
+}
+
+static SCM
+staff_records (staffnode * staff)
+{
+  measurenode *mnode = ((DenemoStaff *) staff->data)->themeasures;
+  SCM ret = scm_c_make_vector (g_list_length (mnode), SCM_BOOL_F);
+  gint i;
+  for (i = 0; mnode; mnode = mnode->next, i++)
+    scm_c_vector_set_x (ret, i, measure_records (mnode));
+  return ret;
+}
+
+SCM
+scheme_get_measure_objects (SCM movement, SCM staff, SCM measure)
+{
+  DenemoMovement *si = movement_for_scm (movement);
+  measurenode *mnode = measurenode_for_scm (si, staffnode_for_scm (si, staff), measure);
+  if (mnode == NULL)
+    return SCM_BOOL_F;
+  return measure_records (mnode);
+}
+
+SCM
+scheme_get_staff_objects (SCM movement, SCM staff)
+{
+  staffnode *snode = staffnode_for_scm (movement_for_scm (movement), staff);
+  if (snode == NULL)
+    return SCM_BOOL_F;
+  return staff_records (snode);
+}
+
+SCM
+scheme_get_movement_objects (SCM movement)
+{
+  DenemoMovement *si = movement_for_scm (movement);
+  staffnode *snode;
+  SCM ret;
+  gint i;
+  if (si == NULL)
+    return SCM_BOOL_F;
+  ret = scm_c_make_vector (g_list_length (si->thescore), SCM_BOOL_F);
+  for (i = 0, snode = si->thescore; snode; snode = snode->next, i++)
+    scm_c_vector_set_x (ret, i, staff_records (snode));
+  return ret;
+}
+
+/* TRUE if notes is a proper list of note records whose pitch and enharmonic shift can be written back */
+static gboolean
+note_records_valid (SCM notes)
+{
+  SCM n;
+  if (scm_ilength (notes) < 0)
+    return FALSE;
+  for (n = notes; scm_is_pair (n); n = scm_cdr (n))
+    {
+      SCM rec = scm_car (n);
+      if (!scm_is_vector (rec) || (scm_c_vector_length (rec) < 2))
+        return FALSE;
+      if (!scm_is_signed_integer (scm_c_vector_ref (rec, 0), G_MININT, G_MAXINT) || !scm_is_signed_integer (scm_c_vector_ref (rec, 1), -2, 2))
+        return FALSE;
+    }
+  return TRUE;
+}
+
+/* TRUE if the object record rec can be written back to obj, for a chord the duration and notes must be well formed */
+static gboolean
+object_record_valid (DenemoObject * obj, SCM rec)
+{
+  if (!scm_is_vector (rec) || (scm_c_vector_length (rec) < 6))
+    return FALSE;
+  if (obj->type != CHORD)
+    return TRUE;
+  return scm_is_signed_integer (scm_c_vector_ref (rec, 3), G_MININT, G_MAXINT) && scm_is_signed_integer (scm_c_vector_ref (rec, 4), 0, G_MAXINT) && note_records_valid (scm_c_vector_ref (rec, 5));
+}
+
+/* TRUE if records is a vector of object records that can all be written back into the measure mnode */
+static gboolean
+measure_records_valid (measurenode * mnode, SCM records)
+{
+  GList *objs = ((DenemoMeasure *) mnode->data)->objects;
+  size_t i, len;
+  if (!scm_is_vector (records))
+    return FALSE;
+  len = scm_c_vector_length (records);
+  for (i = 0; objs && (i < len); objs = objs->next, i++)
+    if (!object_record_valid ((DenemoObject *) objs->data, scm_c_vector_ref (records, i)))
+      return FALSE;
+  return TRUE;
+}
+
+/* TRUE if the notes of thechord are not those given by the valid list of note records notes */
+static gboolean
+chord_notes_differ (chord * thechord, SCM notes)
+{
+  GList *g;
+  SCM n;
+  if (scm_ilength (notes) != (long) g_list_length (thechord->notes))
+    return TRUE;
+  for (g = thechord->notes, n = notes; g; g = g->next, n = scm_cdr (n))
+    {
+      note *thenote = (note *) g->data;
+      SCM rec = scm_car (n);
+      if ((thenote->mid_c_offset != scm_to_int (scm_c_vector_ref (rec, 0))) || (thenote->enshift != scm_to_int (scm_c_vector_ref (rec, 1))))
+        return TRUE;
+    }
+  return FALSE;
+}
+
+/* TRUE if writing the valid object record rec back would change obj, only chords are altered */
+static gboolean
+object_differs_from_record (DenemoObject * obj, SCM rec)
+{
+  chord *thechord;
+  if (obj->type != CHORD)
+    return FALSE;
+  thechord = (chord *) obj->object;
+  if ((scm_to_int (scm_c_vector_ref (rec, 3)) != thechord->baseduration) || (scm_to_int (scm_c_vector_ref (rec, 4)) != thechord->numdots))
+    return TRUE;
+  return chord_notes_differ (thechord, scm_c_vector_ref (rec, 5));
+}
+
+/* TRUE if writing the valid vector of object records back into the measure mnode would change it */
+static gboolean
+measure_differs_from_records (measurenode * mnode, SCM records)
+{
+  GList *objs = ((DenemoMeasure *) mnode->data)->objects;
+  size_t i, len = scm_c_vector_length (records);
+  for (i = 0; objs && (i < len); objs = objs->next, i++)
+    if (object_differs_from_record ((DenemoObject *) objs->data, scm_c_vector_ref (records, i)))
+      return TRUE;
+  return FALSE;
+}
+
+/* replace the notes of the chord obj with those given by the valid list of note records notes.
+ * The note directives stay with the pitch they were on. If there are as many notes as before
+ * a note whose pitch is no longer present passes its directives to the new note in its place,
+ * otherwise they are deleted. */
+static void
+set_chord_notes_from_records (DenemoObject * obj, SCM notes)
+{
+  chord *thechord = (chord *) obj->object;
+  gint i, count = g_list_length (thechord->notes), newcount = scm_ilength (notes);
+  gint *offsets = g_new (gint, count), *enshifts = g_new (gint, count);
+  gint *newoffsets = g_new (gint, newcount), *newenshifts = g_new (gint, newcount);
+  GList **directives = g_new0 (GList *, count);
+  gboolean *claimed = g_new0 (gboolean, count);
+  gint pending_enshift;
+  GList *g;
+  SCM n;
+  for (i = 0, n = notes; i < newcount; n = scm_cdr (n), i++)
+    {
+      newoffsets[i] = scm_to_int (scm_c_vector_ref (scm_car (n), 0));
+      newenshifts[i] = scm_to_int (scm_c_vector_ref (scm_car (n), 1));
+    }
+  for (i = 0, g = thechord->notes; g; g = g->next, i++)
+    {
+      note *thenote = (note *) g->data;
+      offsets[i] = thenote->mid_c_offset;
+      enshifts[i] = thenote->enshift;
+      directives[i] = thenote->directives;
+      thenote->directives = NULL;
+    }
+  while (thechord->notes)
+    removetone (obj, ((note *) thechord->notes->data)->mid_c_offset);
+  pending_enshift = Denemo.project->movement->pending_enshift;
+  Denemo.project->movement->pending_enshift = 0;
+  for (i = 0; i < newcount; i++)
+    addtone (obj, newoffsets[i], newenshifts[i]);
+  Denemo.project->movement->pending_enshift = pending_enshift;
+  for (g = thechord->notes; g; g = g->next)
+    {
+      note *thenote = (note *) g->data;
+      for (i = 0; i < count; i++)
+        if (!claimed[i] && (offsets[i] == thenote->mid_c_offset) && (enshifts[i] == thenote->enshift))
+          {
+            thenote->directives = directives[i];
+            directives[i] = NULL;
+            claimed[i] = TRUE;
+            break;
+          }
+    }
+  if (count == (gint) g_list_length (thechord->notes))
+    for (i = 0, g = thechord->notes; g; g = g->next, i++)
+      {
+        note *thenote = (note *) g->data;
+        gboolean matched = FALSE;
+        gint j;
+        for (j = 0; j < count; j++)
+          matched = matched || (claimed[j] && (offsets[j] == thenote->mid_c_offset) && (enshifts[j] == thenote->enshift));
+        if (!claimed[i] && !matched)
+          {
+            thenote->directives = directives[i];
+            directives[i] = NULL;
+            claimed[i] = TRUE;
+          }
+      }
+  for (i = 0; i < count; i++)
+    if (directives[i])
+      delete_directives (&directives[i]);
+  g_free (offsets);
+  g_free (enshifts);
+  g_free (newoffsets);
+  g_free (newenshifts);
+  g_free (directives);
+  g_free (claimed);
+}
+
+/* write back the durations and notes of the chords in the valid vector of object records into the measure mnode.
+ * Records are matched to objects by index, only chords are altered. Returns the number of objects changed */
+static gint
+set_measure_from_records (measurenode * mnode, SCM records)
+{
+  GList *objs = ((DenemoMeasure *) mnode->data)->objects;
+  size_t i, len = scm_c_vector_length (records);
+  gint count = 0;
+  for (i = 0; objs && (i < len); objs = objs->next, i++)
+    {
+      DenemoObject *obj = (DenemoObject *) objs->data;
+      SCM rec = scm_c_vector_ref (records, i);
+      if (!object_differs_from_record (obj, rec))
+        continue;
+      chord *thechord = (chord *) obj->object;
+      gint base = scm_to_int (scm_c_vector_ref (rec, 3)), dots = scm_to_int (scm_c_vector_ref (rec, 4));
+      SCM notes = scm_c_vector_ref (rec, 5);
+      if ((base != thechord->baseduration) || (dots != thechord->numdots))
+        changedur (obj, base, dots);
+      if (chord_notes_differ (thechord, notes))
+        set_chord_notes_from_records (obj, notes);
+      newclefify (obj);
+      count++;
+    }
+  return count;
+}
+
+/* check the records can be written and snapshot the measures for undo */
+static gboolean
+bulk_write_prepare (DenemoMovement * si, staffnode * snode, gint firstmeasure, gint lastmeasure)
+{
+  gint staffnum;
+  if (si != Denemo.project->movement)
+    return FALSE;               //undo information is per movement, only the current movement can be written
+  staffnum = 1 + g_list_position (si->thescore, snode);
+  take_measures_snapshot (staffnum, staffnum, firstmeasure, lastmeasure);
+  return TRUE;
+}
+
+static void
+bulk_write_finish (gint count)
+{
+  if (count == 0)
+    return;
+  cache_all ();
+  score_status (Denemo.project, TRUE);
+  displayhelper (Denemo.project);
+}
+
+SCM
+scheme_set_measure_objects (SCM records, SCM movement, SCM staff, SCM measure)
+{
+  DenemoMovement *si = movement_for_scm (movement);
+  staffnode *snode = staffnode_for_scm (si, staff);
+  measurenode *mnode = measurenode_for_scm (si, snode, measure);
+  gint count, measurenum;
+  if ((mnode == NULL) || (si != Denemo.project->movement) || !measure_records_valid (mnode, records))
+    return SCM_BOOL_F;          //nothing is changed unless every record can be written
+  if (!measure_differs_from_records (mnode, records))
+    return scm_from_int (0);    //nothing to snapshot for undo or mark as changed
+  measurenum = 1 + g_list_position (((DenemoStaff *) snode->data)->themeasures, mnode);
+  if (!bulk_write_prepare (si, snode, measurenum, measurenum))
+    return SCM_BOOL_F;
+  count = set_measure_from_records (mnode, records);
+  bulk_write_finish (count);
+  return scm_from_int (count);
+}
+
+SCM
+scheme_set_staff_objects (SCM records, SCM movement, SCM staff)
+{
+  DenemoMovement *si = movement_for_scm (movement);
+  staffnode *snode = staffnode_for_scm (si, staff);
+  measurenode *mnode;
+  size_t i, len;
+  gint count = 0, first = 0, last = 0;
+  if ((snode == NULL) || !scm_is_vector (records) || (si != Denemo.project->movement))
+    return SCM_BOOL_F;
+  len = scm_c_vector_length (records);
+  for (i = 0, mnode = ((DenemoStaff *) snode->data)->themeasures; mnode && (i < len); mnode = mnode->next, i++)
+    if (!measure_records_valid (mnode, scm_c_vector_ref (records, i)))
+      return SCM_BOOL_F;        //nothing is changed unless every record can be written
+  for (i = 0, mnode = ((DenemoStaff *) snode->data)->themeasures; mnode && (i < len); mnode = mnode->next, i++)
+    if (measure_differs_from_records (mnode, scm_c_vector_ref (records, i)))
+      {
+        if (first == 0)
+          first = i + 1;
+        last = i + 1;
+      }
+  if (first == 0)
+    return scm_from_int (0);    //nothing to snapshot for undo or mark as changed
+  if (!bulk_write_prepare (si, snode, first, last))
+    return SCM_BOOL_F;
+  for (i = first - 1, mnode = g_list_nth (((DenemoStaff *) snode->data)->themeasures, first - 1); mnode && (i < (size_t) last); mnode = mnode->next, i++)
+    count += set_measure_from_records (mnode, scm_c_vector_ref (records, i));
+  bulk_write_finish (count);
+  return scm_from_int (count);
+}
+
 SCM
 scheme_get_note (SCM count)
 {
@@ -4765,6 +5198,26 @@ SCM scheme_create_pdf_from_lilyfile (SCM lily, SCM out)
 	return SCM_BOOL_F;
 }
 
+SCM scheme_export_parts_pdf (SCM filename)
+{
+  DenemoProject *gui = Denemo.project;
+  gchar *name;
+  gboolean ret;
+  if (scm_is_string (filename))
+    {
+      char *str = scm_to_locale_string (filename);
+      name = g_strdup (str);
+      free (str);
+    }
+  else if (gui->filename->len)
+    name = g_strdup (gui->filename->str);
+  else
+    name = g_build_filename (locateprintdir (), "denemoparts", NULL);
+  ret = export_parts_pdf (name, gui);
+  g_free (name);
+  return SCM_BOOL (ret);
+}
+
 static gchar **get_vector (SCM list)
 {
 	gchar **arg = NULL;
@@ -6368,6 +6821,16 @@ scheme_put_midi (SCM scm)
   return SCM_BOOL (TRUE);
 }
 
+SCM
+scheme_get_midi_input_latency (SCM reset)
+{
+  gdouble last, mean, max;
+  guint count = get_midi_input_latency (&last, &mean, &max, scm_is_bool (reset) && scm_is_true (reset));
+  if (count == 0)
+    return SCM_BOOL_F;
+  return scm_list_4 (scm_from_uint (count), scm_from_double (last), scm_from_double (mean), scm_from_double (max));
+}
+
 SCM
 scheme_output_midi (SCM scm)
 {
@@ -7750,6 +8213,19 @@ scheme_refresh_display (SCM optional)
   return SCM_BOOL (TRUE);
 }
 
+SCM
+scheme_begin_batch (SCM optional)
+{
+  begin_batch_edit ();
+  return SCM_BOOL_T;
+}
+
+SCM
+scheme_end_batch (SCM optional)
+{
+  return SCM_BOOL (end_batch_edit ());
+}
+
 SCM
 scheme_keep_alive (SCM optional)
 {
@@ -135,6 +135,11 @@ SCM scheme_get_note_staff_position (SCM);
 SCM scheme_get_note_from_top (SCM);
 SCM scheme_get_note_from_top_as_midi (SCM);
 SCM scheme_get_notes (SCM);
+SCM scheme_get_measure_objects (SCM, SCM, SCM);
+SCM scheme_get_staff_objects (SCM, SCM);
+SCM scheme_get_movement_objects (SCM);
+SCM scheme_set_measure_objects (SCM, SCM, SCM, SCM);
+SCM scheme_set_staff_objects (SCM, SCM, SCM);
 SCM scheme_get_note_at_cursor (void);
 SCM scheme_get_dots (void);
 SCM scheme_get_note_base_duration (void);
@@ -250,6 +255,7 @@ SCM scheme_print_typeset_pdf (void);
 SCM scheme_get_current_typeset_pdf (void);
 SCM scheme_execute_external_program (SCM args, SCM env);
 SCM scheme_create_pdf_from_lilyfile (SCM lilyfilename, SCM pdfbasename);
+SCM scheme_export_parts_pdf (SCM filename);
 SCM scheme_display_typeset_svg (SCM scaling, SCM part);
 SCM scheme_continuous_typesetting (void);
 SCM scheme_get_char (void);
@@ -292,6 +298,7 @@ SCM scheme_insert_marked_midi_note (void);
 
 SCM scheme_create_timebase (SCM);
 SCM scheme_put_midi (SCM);
+SCM scheme_get_midi_input_latency (SCM);
 SCM scheme_output_midi (SCM);
 SCM scheme_output_midi_bytes (SCM);
 SCM scheme_play_midikey (SCM);
@@ -309,6 +316,8 @@ SCM scheme_get_cursor_note_as_midi (SCM);
 SCM scheme_get_note_as_midi (void);
 SCM scheme_refresh_cache (void);
 SCM scheme_refresh_display (SCM);
+SCM scheme_begin_batch (SCM);
+SCM scheme_end_batch (SCM);
 SCM scheme_keep_alive (SCM);
 SCM scheme_set_saved (SCM);
 SCM scheme_changecount (SCM);
@@ -399,6 +408,7 @@ SCM scheme_toggle_recording_audio (void);
 SCM scheme_recording_audio (void);
 SCM scheme_open_source_file (SCM);
 SCM scheme_open_proofread_file (SCM);
+SCM scheme_render_audio (SCM name, SCM stems);
 SCM scheme_open_source_audio_file (SCM);
 SCM scheme_close_source_audio (SCM);
 SCM scheme_start_audio_play (SCM);
@@ -185,6 +185,11 @@ create_scheme_identfiers (void)
   install_scm_function (0, "Takes optional integer parameter n = 1..., returns LilyPond representation of the nth note of the chord at the cursor counting from the highest, or #f if none", DENEMO_SCHEME_PREFIX "GetNoteFromTop", scheme_get_note_from_top);
   install_scm_function (0, "Takes optional integer parameter n = 1..., returns MIDI key for the nth note of the chord at the cursor counting from the highest, or #f if none", DENEMO_SCHEME_PREFIX "GetNoteFromTopAsMidi", scheme_get_note_from_top_as_midi);
   install_scm_function (0, "Returns a space separated string of LilyPond notes for the chord at the cursor position or #f if none", DENEMO_SCHEME_PREFIX "GetNotes", scheme_get_notes);
+  install_scm_function (3, "Takes optional movement, staff and measure numbers (default or #f for the cursor position). Returns a vector of object records for the measure without moving the cursor, or #f if there is no such measure. Each record is a vector #(type start-tick duration-in-ticks baseduration numdots notes tags), notes being a list of vectors #(mid_c_offset enshift lilypond-name midi-key tags) and tags lists of directive tags", DENEMO_SCHEME_PREFIX "GetMeasureObjects", scheme_get_measure_objects);
+  install_scm_function (2, "Takes a movement and staff number (#f for the cursor position). Returns a vector holding the object records of each measure of the staff (see GetMeasureObjects) without moving the cursor, or #f if there is no such staff", DENEMO_SCHEME_PREFIX "GetStaffObjects", scheme_get_staff_objects);
+  install_scm_function (0, "Takes an optional movement number (default the current movement). Returns a vector holding the staff object records of each staff in the movement (see GetStaffObjects) without moving the cursor, or #f if there is no such movement", DENEMO_SCHEME_PREFIX "GetMovementObjects", scheme_get_movement_objects);
+  install_scm_function (4, "Takes a vector of object records (as returned by GetMeasureObjects) and optional movement, staff and measure numbers (default or #f for the cursor position), only the current movement can be written. Writes back the baseduration, numdots and notes of each record to the chord at the same index in the measure, other objects are left unchanged. Undo restores the measure. Returns the number of objects changed or #f, leaving the measure unchanged, if the measure does not exist or a record is malformed", DENEMO_SCHEME_PREFIX "SetMeasureObjects", scheme_set_measure_objects);
+  install_scm_function (3, "Takes a vector of measure records (as returned by GetStaffObjects) and optional movement (#f or current) and staff number. Writes them back as for SetMeasureObjects. Returns the number of objects changed or #f, leaving the staff unchanged, if the staff does not exist or any record is malformed", DENEMO_SCHEME_PREFIX "SetStaffObjects", scheme_set_staff_objects);
   install_scm_function (0, "Returns LilyPond note at the cursor position or #f if none", DENEMO_SCHEME_PREFIX "GetNoteAtCursor", scheme_get_note_at_cursor);
   install_scm_function (0, "Returns the number of dots on the note at the cursor, or #f if no note", DENEMO_SCHEME_PREFIX "GetDots", scheme_get_dots);
   install_scm_function (0, "Returns the base duration of the note at the cursor number=0, 1, 2 for whole half quarter note etc, or #f if none", DENEMO_SCHEME_PREFIX "GetNoteBaseDuration", scheme_get_note_base_duration);
@@ -336,6 +341,7 @@ create_scheme_identfiers (void)
   install_scm_function (0, "Returns file name of the most recently typeset PDF.", DENEMO_SCHEME_PREFIX "GetCurrentTypesetPDF", scheme_get_current_typeset_pdf);
   install_scm_function (2, "Takes an argument list and environment variable list and executes the program at the head of the argument list returning any standard output.", DENEMO_SCHEME_PREFIX "ExecuteExternalProgram", scheme_execute_external_program);
   install_scm_function (2, "Takes LilyPond file and name for PDF file. Synchronously generates name.pdf from the LilyPond file.", DENEMO_SCHEME_PREFIX "CreatePDFFromLilyfile", scheme_create_pdf_from_lilyfile);
+  install_scm_function (0, "Typesets each part of the score, all movements, to a separate PDF file named from the optional filename (default the score's file name) with _partname appended. Several LilyPond processes are run at once, see Preferences. Returns #f if the typesetting could not be started.", DENEMO_SCHEME_PREFIX "ExportPartsPDF", scheme_export_parts_pdf);
   install_scm_function (2, "Displays the SVG file generated by LilyPond for playback. Takes a scale and a boolean (true if only the current part is to be typeset)", DENEMO_SCHEME_PREFIX "DisplayTypesetSvg", scheme_display_typeset_svg);
   install_scm_function (0, "Returns #t if continuous typesetting is in operation else #f", DENEMO_SCHEME_PREFIX "ContinuousTypesetting", scheme_continuous_typesetting);
 
@@ -1131,6 +1137,7 @@ create_scheme_identfiers (void)
 
 
   install_scm_function (1, "Takes and int as MIDI data and simulates a midi event, avoiding capturing of midi by scripts. Value 0 is special and is received by scripts.", DENEMO_SCHEME_PREFIX "PutMidi", scheme_put_midi);
+  install_scm_function (0, "Takes an optional boolean, #t to start afresh. Returns a list (count last mean max) of the number of MIDI input events and the latency in milliseconds of the last one, the mean and the greatest since starting afresh, from the MIDI backend receiving an event to Denemo handling it, or #f if there has been no MIDI input since starting afresh", DENEMO_SCHEME_PREFIX "GetMidiInputLatency", scheme_get_midi_input_latency);
   install_scm_function (1, "Takes and int as MIDI data and sends it directly to the MIDI out backend", DENEMO_SCHEME_PREFIX "OutputMidi", scheme_output_midi);
 
 
@@ -1154,6 +1161,8 @@ create_scheme_identfiers (void)
   install_scm_function (0, "Gets the MIDI key number for the note-position where the cursor is", DENEMO_SCHEME_PREFIX "GetCursorNoteAsMidi", scheme_get_cursor_note_as_midi);
   install_scm_function (0, "Returns the MIDI key number for the note at the cursor, or 0 if none", DENEMO_SCHEME_PREFIX "GetNoteAsMidi", scheme_get_note_as_midi);
   install_scm_function (0, "Re-draws the Denemo display, which can have side effects on the data, updates status bar ... ", DENEMO_SCHEME_PREFIX "RefreshDisplay", scheme_refresh_display);
+  install_scm_function (0, "Starts a batch of edits: status bar, title, layout and redraw are deferred and the edits form a single undo stage until the matching EndBatch. Prefer (d-Batch thunk) which ensures the batch is ended. Returns #t", DENEMO_SCHEME_PREFIX "BeginBatch", scheme_begin_batch);
+  install_scm_function (0, "Ends a batch of edits started with BeginBatch. When the outermost batch ends the movement is re-laid out and redrawn once. Returns #f if no batch was in progress", DENEMO_SCHEME_PREFIX "EndBatch", scheme_end_batch);
   install_scm_function (0, "Keeps the GUI alive during long scripts ", DENEMO_SCHEME_PREFIX "KeepAlive", scheme_keep_alive);
   install_scm_function (0, "Computes cached values (normally done while drawing)", DENEMO_SCHEME_PREFIX "RefreshCache", scheme_refresh_cache);
   install_scm_function (0, "Sets the status of the current musical score to saved, or unsaved if passed #f", DENEMO_SCHEME_PREFIX "SetSaved", scheme_set_saved);
@@ -1219,7 +1228,7 @@ create_scheme_identfiers (void)
 
   install_scm_function (0, "Sets the selection to be used for a thumbnail. Returns #f if no selection or selection not in first movement else #t.", DENEMO_SCHEME_PREFIX "SetThumbnailSelection", scheme_set_thumbnail_selection);
 
-  install_scm_function (1, "Creates a thumbnail for the current score. With no argument it waits for the thumbnail to complete, freezing any display. With #t it generates the thumbnail asynchronously. It does not report on completion.", DENEMO_SCHEME_PREFIX "CreateThumbnail", scheme_create_thumbnail);
+  install_scm_function (1, "Creates a thumbnail for the current score. With no argument it waits for the thumbnail to complete, freezing any display. With #t the thumbnail is made in the background from the saved file. It does not report on completion.", DENEMO_SCHEME_PREFIX "CreateThumbnail", scheme_create_thumbnail);
 
   install_scm_function (0, "Exits Denemo without saving history, prefs etc.", DENEMO_SCHEME_PREFIX "Exit", scheme_exit);
 
@@ -1274,6 +1283,7 @@ create_scheme_identfiers (void)
   install_scm_function (3, "Takes an optional filename and optional new name. Opens an encapsulated postscript file for editing. Returns the filename (without extension) if successful.\nStarts the graphics editor on the passed in filename or one from a dialog.\nThe returned .eps file may not exist when this procedure returns, an editor is open on it. With no filename parameter allows the user to choose,\ncopying to the project directory or the users graphics templates (if a new name is given)", DENEMO_SCHEME_PREFIX "EditGraphics", scheme_edit_graphics);
   install_scm_function (0, "Opens a PDF file previously generated by Denemo which has proof reading annotations. The notes in the file can be clicked on to locate the music in the Denemo display", DENEMO_SCHEME_PREFIX "OpenProofReadFile", scheme_open_proofread_file);
   install_scm_function (0, "Opens a source file for transcribing from. Links to this source file can be placed by shift-clicking on its contents", DENEMO_SCHEME_PREFIX "OpenSourceFile", scheme_open_source_file);
+  install_scm_function (3, "Takes an optional filename (.wav, .ogg or .flac) and an optional boolean. Renders the current movement to the audio file (chosen by the user if none is given) by driving the synthesizer directly from the MIDI, so it takes only as long as the computation, not the duration of the music. If the boolean is #t each staff is rendered to a file of its own, named from the filename and the staff. Returns #f if it failed.", DENEMO_SCHEME_PREFIX "RenderAudio", scheme_render_audio);
 
 
 #ifdef DISABLE_AUBIO
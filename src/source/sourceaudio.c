@@ -25,8 +25,18 @@
     {
       return FALSE;
     }
+    gboolean
+    get_audio_peaks (DenemoRecording * recording, gint64 start, gdouble frames_per_pixel, gint npixels, float *mins, float *maxs)
+    {
+      return FALSE;
+    }
+    void
+    free_audio_peaks (gpointer peaks)
+    {
+    }
 #else
 #include <stdio.h>
+#include <string.h>
 #include <sndfile.h>
 #include <fcntl.h>
 #include <aubio/aubio.h>
@@ -55,66 +65,392 @@ static gboolean playing = FALSE;
 #include "command/keyresponses.h"
 #include "audio/audiointerface.h"
 
-//Creates a list of times which the aubio onset detector thinks are note onset times for the audio Denemo->si->recording
-//Result is placed in Denemo->si->note_onsets
-void
-generate_note_onsets (void)
+#define ONSET_BLOCK (8192)      //frames read from the audio file at a time
+#define ONSET_WINDOW (1024)
+#define ONSET_HOP (512)
+#define ONSET_CACHE_HEADER "denemo-onsets 1"
+#define PEAK_FRAMES (256)       //frames summarized by each peak at the finest level
+#define PEAK_CACHE_HEADER "denemo-peaks 1"
+
+/* The extent of the audio over a run of frames */
+typedef struct AudioPeak
 {
-  DenemoRecording *audio = Denemo.project->movement->recording;
-  gint channels = audio->channels;
+  float min;
+  float max;
+} AudioPeak;
+
+/* The peaks of the audio, the first level summarizing PEAK_FRAMES frames per peak, each later level twice as many as the one before,
+ * so that any stretch of audio can be drawn at any scale by looking at a few peaks per pixel. */
+typedef struct AudioPeaks
+{
+  GPtrArray *levels;            //GArrays of AudioPeak
+} AudioPeaks;
 
- smpl_t threshold = 0.3;
- smpl_t silence = -90.;
- uint_t buffer_size = 1024;
- uint_t overlap_size = 512;
+/* The onsets and peaks are found on a thread of their own, and cached in files beside the audio, keyed by a hash of the audio,
+ * so that opening the same audio again does not repeat the analysis. */
+typedef struct OnsetJob
+{
+  gchar *filename;
+  DenemoRecording *recording;   //the recording the onsets are for
+  gint generation;
+  aubio_onset_t *onset;
+  GArray *timings;              //the frames at which onsets were found
+  GArray *peaks;                //AudioPeaks of the finest level
+  AudioPeaks *audio_peaks;      //the peaks at all levels, when complete
+  gint cancelled;
+} OnsetJob;
+
+static OnsetJob *onset_job;     //the analysis in progress, if any
+static gint onset_generation;
+
+static gchar *
+audio_file_hash (const gchar * filename)
+{
+  GChecksum *checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  guchar buf[65536];
+  size_t n;
+  gchar *hash = NULL;
+  FILE *fp = fopen (filename, "rb");
+  if (fp)
+    {
+      while ((n = fread (buf, 1, sizeof (buf), fp)) > 0)
+        g_checksum_update (checksum, buf, n);
+      fclose (fp);
+      hash = g_strdup (g_checksum_get_string (checksum));
+    }
+  g_checksum_free (checksum);
+  return hash;
+}
+
+static gchar *
+onset_cache_filename (const gchar * filename)
+{
+  return g_strconcat (filename, ".onsets", NULL);
+}
+
+static gboolean
+read_onset_cache (OnsetJob * job, const gchar * hash)
+{
+  gchar *cache = onset_cache_filename (job->filename);
+  gchar *header = g_strdup_printf ("%s %s", ONSET_CACHE_HEADER, hash);
+  gchar *contents;
+  gboolean ok = FALSE;
+  if (g_file_get_contents (cache, &contents, NULL, NULL))
+    {
+      gchar **lines = g_strsplit (contents, "\n", -1);
+      ok = lines[0] && !strcmp (lines[0], header);
+      if (ok)
+        {
+          gchar **line;
+          for (line = lines + 1; *line; line++)
+            if (**line)
+              {
+                gint timing = (gint) g_ascii_strtoll (*line, NULL, 10);
+                g_array_append_val (job->timings, timing);
+              }
+        }
+      g_strfreev (lines);
+      g_free (contents);
+    }
+  g_free (header);
+  g_free (cache);
+  return ok;
+}
 
- uint_t samplerate = 44100;
+static void
+write_onset_cache (OnsetJob * job, const gchar * hash)
+{
+  gchar *cache = onset_cache_filename (job->filename);
+  GString *contents = g_string_new (ONSET_CACHE_HEADER);
+  guint i;
+  g_string_append_printf (contents, " %s\n", hash);
+  for (i = 0; i < job->timings->len; i++)
+    g_string_append_printf (contents, "%d\n", g_array_index (job->timings, gint, i));
+  if (!g_file_set_contents (cache, contents->str, contents->len, NULL))
+    g_debug ("Could not cache the onsets in %s", cache);
+  g_string_free (contents, TRUE);
+  g_free (cache);
+}
 
- aubio_onset_t *o = new_aubio_onset("default",
-     buffer_size, overlap_size, samplerate);
- fvec_t *ibuf = new_fvec (overlap_size);
- fvec_t *onset = new_fvec (2);
+static gchar *
+peak_cache_filename (const gchar * filename)
+{
+  return g_strconcat (filename, ".peaks", NULL);
+}
 
-  unsigned int pos = 0;         /*frames%dspblocksize */
-  unsigned int i;               /*channels */
-  unsigned int j;               /*frames */
+/* the peaks are cached as a header line followed by the finest level in native byte order */
+static gboolean
+read_peak_cache (OnsetJob * job, const gchar * hash)
+{
+  gchar *cache = peak_cache_filename (job->filename);
+  gchar *header = g_strdup_printf ("%s %s ", PEAK_CACHE_HEADER, hash);
+  gchar *contents;
+  gsize length;
+  gboolean ok = FALSE;
+  if (g_file_get_contents (cache, &contents, &length, NULL))
+    {
+      gchar *data = memchr (contents, '\n', length);
+      if (data && g_str_has_prefix (contents, header))
+        {
+          guint npeaks = (guint) g_ascii_strtoull (contents + strlen (header), NULL, 10);
+          data++;
+          ok = ((gsize) (contents + length - data) == npeaks * sizeof (AudioPeak));
+          if (ok)
+            g_array_append_vals (job->peaks, data, npeaks);
+        }
+      g_free (contents);
+    }
+  g_free (header);
+  g_free (cache);
+  return ok;
+}
 
-  busy_cursor (Denemo.notebook);
-  gtk_window_set_modal (progressbar (_("Analysing Audio"), NULL), TRUE);
+static void
+write_peak_cache (OnsetJob * job, const gchar * hash)
+{
+  gchar *cache = peak_cache_filename (job->filename);
+  gchar *header = g_strdup_printf ("%s %s %u\n", PEAK_CACHE_HEADER, hash, job->peaks->len);
+  FILE *fp = fopen (cache, "wb");
+  if (fp == NULL || fputs (header, fp) < 0 || fwrite (job->peaks->data, sizeof (AudioPeak), job->peaks->len, fp) != job->peaks->len)
+    g_debug ("Could not cache the peaks in %s", cache);
+  if (fp)
+    fclose (fp);
+  g_free (header);
+  g_free (cache);
+}
 
-  rewind_audio ();
-  if (audio->notes)
+/* build the coarser levels of peaks from the finest */
+static AudioPeaks *
+new_audio_peaks (GArray * finest)
+{
+  AudioPeaks *peaks = (AudioPeaks *) g_malloc0 (sizeof (AudioPeaks));
+  peaks->levels = g_ptr_array_new ();
+  g_ptr_array_add (peaks->levels, finest);
+  while (finest->len > 1)
     {
-      g_list_free_full (audio->notes, g_free);
-      audio->notes = NULL;
+      GArray *coarser = g_array_sized_new (FALSE, FALSE, sizeof (AudioPeak), (finest->len + 1) / 2);
+      guint i;
+      for (i = 0; i < finest->len; i += 2)
+        {
+          AudioPeak peak = g_array_index (finest, AudioPeak, i);
+          if (i + 1 < finest->len)
+            {
+              AudioPeak *next = &g_array_index (finest, AudioPeak, i + 1);
+              peak.min = MIN (peak.min, next->min);
+              peak.max = MAX (peak.max, next->max);
+            }
+          g_array_append_val (coarser, peak);
+        }
+      g_ptr_array_add (peaks->levels, coarser);
+      finest = coarser;
     }
-  for (j = 0; j < (unsigned) audio->nframes; j++)
+  return peaks;
+}
+
+void
+free_audio_peaks (gpointer peaks)
+{
+  if (peaks)
+    {
+      GPtrArray *levels = ((AudioPeaks *) peaks)->levels;
+      guint i;
+      for (i = 0; i < levels->len; i++)
+        g_array_free (g_ptr_array_index (levels, i), TRUE);
+      g_ptr_array_free (levels, TRUE);
+      g_free (peaks);
+    }
+}
+
+/**
+ * Fill mins and maxs with the extent of the audio of recording for each of npixels columns of frames_per_pixel frames,
+ * the first starting at frame start (which may be negative).
+ * Only a few peaks are examined for each pixel, whatever the scale, so this can be called on every redraw.
+ * Returns FALSE if the peaks of the audio are not (yet) known.
+ */
+gboolean
+get_audio_peaks (DenemoRecording * recording, gint64 start, gdouble frames_per_pixel, gint npixels, float *mins, float *maxs)
+{
+  AudioPeaks *peaks = recording ? (AudioPeaks *) recording->peaks : NULL;
+  GArray *level;
+  guint n = 0;
+  gint64 span;
+  gint p;
+  if ((peaks == NULL) || (frames_per_pixel <= 0.0))
+    return FALSE;
+  while ((n + 1 < peaks->levels->len) && (((gint64) PEAK_FRAMES << (n + 1)) <= frames_per_pixel))
+    n++;
+  level = (GArray *) g_ptr_array_index (peaks->levels, n);
+  span = (gint64) PEAK_FRAMES << n;
+  for (p = 0; p < npixels; p++)
     {
-      sf_read_float (audio->sndfile, ibuf->data + pos, 2);   //g_debug("\t%f", ibuf->data[0][pos]);
-      if (pos == overlap_size - 1)
+      gint64 from = start + (gint64) (p * frames_per_pixel);
+      gint64 to = start + (gint64) ((p + 1) * frames_per_pixel);
+      gint64 i, last;
+      mins[p] = maxs[p] = 0.0;
+      if (to <= 0)
+        continue;
+      last = MIN ((to - 1) / span, (gint64) level->len - 1);
+      for (i = MAX (from, 0) / span; i <= last; i++)
         {
-          /* block loop */
-          gtk_main_iteration_do (FALSE);
-          aubio_onset_do (o, ibuf, onset);
-          while (gtk_events_pending ())
-            gtk_main_iteration ();
-          if(onset->data[0] != 0) {
-              DenemoRecordedNote *note = g_malloc0(sizeof(DenemoRecordedNote));
-              note->timing = aubio_onset_get_last(o);/* aubio_onset_get_delay_s(o) for seconds */
-            audio->notes = g_list_append (audio->notes, note);// g_print ("Onset found timing %d\n", (gint)note->timing);
+          AudioPeak *peak = &g_array_index (level, AudioPeak, i);
+          mins[p] = MIN (mins[p], peak->min);
+          maxs[p] = MAX (maxs[p], peak->max);
+        }
+    }
+  return TRUE;
+}
+
+/* read the audio in blocks, mixing the channels down to one, and pass it to the onset detector a hop at a time
+ * and/or collect its peaks */
+static void
+analyse_audio (OnsetJob * job, gboolean onsets, gboolean peaks)
+{
+  SF_INFO sfinfo;
+  SNDFILE *sndfile;
+  fvec_t *hop, *found;
+  float *block;
+  sf_count_t n, i;
+  guint pos = 0, peak_pos = 0;
+  AudioPeak peak = { 0.0, 0.0 };
+  gint c;
+  memset (&sfinfo, 0, sizeof (sfinfo));
+  sndfile = sf_open (job->filename, SFM_READ, &sfinfo);
+  if (sndfile == NULL)
+    return;
+  hop = new_fvec (ONSET_HOP);
+  found = new_fvec (1);
+  block = g_new (float, ONSET_BLOCK * sfinfo.channels);
+  while (!g_atomic_int_get (&job->cancelled) && ((n = sf_readf_float (sndfile, block, ONSET_BLOCK)) > 0))
+    for (i = 0; i < n; i++)
+      {
+        smpl_t sum = 0.0;
+        for (c = 0; c < sfinfo.channels; c++)
+          sum += block[i * sfinfo.channels + c];
+        sum /= sfinfo.channels;
+        if (peaks)
+          {
+            peak.min = MIN (peak.min, sum);
+            peak.max = MAX (peak.max, sum);
+            if (++peak_pos == PEAK_FRAMES)
+              {
+                g_array_append_val (job->peaks, peak);
+                peak.min = peak.max = 0.0;
+                peak_pos = 0;
+              }
+          }
+        if (!onsets)
+          continue;
+        hop->data[pos++] = sum;
+        if (pos == ONSET_HOP)
+          {
+            aubio_onset_do (job->onset, hop, found);
+            if (found->data[0] != 0)
+              {
+                gint timing = aubio_onset_get_last (job->onset); /* aubio_onset_get_delay_s(o) for seconds */
+                g_array_append_val (job->timings, timing);
+              }
+            pos = 0;
           }
-          pos = -1;             /* so it will be zero next j loop */
-        }                       /* end of if pos==overlap_size-1 */
-      pos++;
+      }
+  if (peak_pos)
+    g_array_append_val (job->peaks, peak);
+  g_free (block);
+  del_fvec (hop);
+  del_fvec (found);
+  sf_close (sndfile);
+}
+
+/* on the main thread, give the onsets and peaks found to the recording they were for, if it is still there */
+static gboolean
+onsets_found (OnsetJob * job)
+{
+  DenemoRecording *audio = Denemo.project->movement ? Denemo.project->movement->recording : NULL;
+  if (job == onset_job)
+    onset_job = NULL;
+  if (!job->cancelled && (job->generation == onset_generation) && (audio == job->recording))
+    {
+      GList *notes = NULL;
+      guint i;
+      for (i = job->timings->len; i > 0; i--)
+        {
+          DenemoRecordedNote *note = g_malloc0 (sizeof (DenemoRecordedNote));
+          note->timing = g_array_index (job->timings, gint, i - 1);
+          notes = g_list_prepend (notes, note);
+        }
+      g_list_free_full (audio->notes, g_free);
+      audio->notes = notes;
+      if (audio->notes == NULL)
+        g_warning ("No onsets found\n");
+      free_audio_peaks (audio->peaks);
+      audio->peaks = job->audio_peaks;
+      job->audio_peaks = NULL;
+      draw_score_area ();
     }
-if (audio->notes==NULL) g_warning ("No onsets found\n");
-  del_aubio_onset (o);
-  del_fvec (ibuf);
-  del_fvec (onset);
-  aubio_cleanup ();
-  progressbar_stop ();
-  normal_cursor (Denemo.notebook);
+  if (job->audio_peaks)
+    free_audio_peaks (job->audio_peaks);
+  if (job->peaks)
+    g_array_free (job->peaks, TRUE);
+  del_aubio_onset (job->onset);
+  g_array_free (job->timings, TRUE);
+  g_free (job->filename);
+  g_free (job);
+  return FALSE;
 }
+
+static gpointer
+onset_thread (OnsetJob * job)
+{
+  gchar *hash = audio_file_hash (job->filename);
+  gboolean onsets = !(hash && read_onset_cache (job, hash));
+  gboolean peaks = !(hash && read_peak_cache (job, hash));
+  if (onsets || peaks)
+    {
+      analyse_audio (job, onsets, peaks);
+      if (hash && !g_atomic_int_get (&job->cancelled))
+        {
+          if (onsets)
+            write_onset_cache (job, hash);
+          if (peaks)
+            write_peak_cache (job, hash);
+        }
+    }
+  if (!g_atomic_int_get (&job->cancelled) && job->peaks->len)
+    {
+      job->audio_peaks = new_audio_peaks (job->peaks);        //which now owns the array
+      job->peaks = NULL;
+    }
+  g_free (hash);
+  g_idle_add ((GSourceFunc) onsets_found, job);
+  return NULL;
+}
+
+//Starts finding the times which the aubio onset detector thinks are note onset times for the audio Denemo->si->recording
+//The result is placed in the notes of the recording when it is ready, any previous analysis still running is abandoned.
+void
+generate_note_onsets (void)
+{
+  DenemoRecording *audio = Denemo.project->movement->recording;
+  OnsetJob *job;
+  GThread *thread;
+  if (onset_job)
+    g_atomic_int_set (&onset_job->cancelled, TRUE);
+  g_list_free_full (audio->notes, g_free);
+  audio->notes = NULL;
+  job = (OnsetJob *) g_malloc0 (sizeof (OnsetJob));
+  job->filename = g_strdup (audio->filename);
+  job->recording = audio;
+  job->generation = ++onset_generation;
+  job->timings = g_array_new (FALSE, FALSE, sizeof (gint));
+  job->peaks = g_array_new (FALSE, FALSE, sizeof (AudioPeak));
+  job->onset = new_aubio_onset ("default", ONSET_WINDOW, ONSET_HOP, audio->samplerate);   //made here, as the FFT planning is best not done on another thread
+  onset_job = job;
+  thread = g_thread_try_new ("Onset detection", (GThreadFunc) onset_thread, job, NULL);
+  if (thread)
+    g_thread_unref (thread);
+  else
+    onset_thread (job);
+}
+
 gboolean
 get_audio_sample (float *sample)
 {
@@ -149,6 +485,8 @@ open_source_audio (gchar * filename)
   DenemoRecording *temp;
   sfinfo.format = 0;
 
+  if (onset_job)
+    g_atomic_int_set (&onset_job->cancelled, TRUE);
   delete_recording();
 
   if (filename)
@@ -156,7 +494,7 @@ open_source_audio (gchar * filename)
       gpointer sndfile = sf_open (filename, SFM_READ, &sfinfo);
       if (sndfile)
         {
-          temp = (DenemoRecording *) g_malloc (sizeof (DenemoRecording));
+          temp = (DenemoRecording *) g_malloc0 (sizeof (DenemoRecording));
           temp->type = DENEMO_RECORDING_AUDIO;
           temp->sndfile = sndfile;
           temp->filename = g_strdup (filename);
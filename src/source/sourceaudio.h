@@ -42,4 +42,8 @@ void stop_audio_playing (void);
 gdouble get_audio_timing (void);
 gboolean set_lead_in (gdouble secs);
 gboolean open_source_audio_file (void);
+
+//get the extent of the audio for each of npixels pixels of frames_per_pixel frames, starting at frame start
+gboolean get_audio_peaks (DenemoRecording * recording, gint64 start, gdouble frames_per_pixel, gint npixels, float *mins, float *maxs);
+void free_audio_peaks (gpointer peaks);
 #endif
@@ -88,6 +88,9 @@ struct callbackdata
   GtkWidget *autosave_timeout;
   GtkWidget *compression;
   GtkWidget *maxhistory;
+  GtkWidget *undo_memory_limit;
+  GtkWidget *typeset_cache_size;
+  GtkWidget *max_typeset_jobs;
   GtkWidget *browser;
   GtkWidget *pdfviewer;
   GtkWidget *imageviewer;
@@ -302,6 +305,9 @@ set_preferences (struct callbackdata *cbdata)
     ASSIGNBOOLEAN (continuous)
     ASSIGNINT (resolution)
     ASSIGNINT (maxhistory)
+    ASSIGNINT (undo_memory_limit)
+    ASSIGNINT (typeset_cache_size)
+    ASSIGNINT (max_typeset_jobs)
     ASSIGNBOOLEAN (damping)
     ASSIGNINT (dynamic_compression)
     ASSIGNINT (recording_timeout)
@@ -650,6 +656,8 @@ preferences_change (GtkAction * action, DenemoScriptParam * param)
   INTENTRY_LIMITS (_("Measures after cursor"), lastmeasure, 0, 100);
   INTENTRY_LIMITS (_("Staffs before cursor"), firststaff, 0, 100);
   INTENTRY_LIMITS (_("Staffs after cursor"), laststaff, 0, 100);
+  INTENTRY_LIMITS (_("Cache of typeset output (MB, 0 to disable)"), typeset_cache_size, 0, 4096);
+  INTENTRY_LIMITS (_("LilyPond processes when typesetting parts (0 for one per processor)"), max_typeset_jobs, 0, 64);
   /*
    * Misc Menu
    */
@@ -669,6 +677,7 @@ preferences_change (GtkAction * action, DenemoScriptParam * param)
   BOOLEANENTRY (_("Auto Open Sources on File Load"), opensources);
   BOOLEANENTRY (_("Ignore Scheme Scripts on File Load"), ignorescripts);
   INTENTRY_LIMITS (_("Max recent files"), maxhistory, 0, 100);
+  INTENTRY_LIMITS (_("Undo memory limit per movement (MB, 0 for no limit)"), undo_memory_limit, 0, 4096);
   TEXTENTRY (_("User Name"), username)
   //PASSWORDENTRY (_("Password for Denemo.org"), password)
   BOOLEANENTRY (_("Create Parts Layouts"), saveparts);
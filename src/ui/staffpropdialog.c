@@ -25,6 +25,7 @@
 #include "audio/audiointerface.h"
 
 extern int ParseSoundfont (gchar * soundfont, gint index, gchar ** name, gint * preset, gint * bank);        //in "external" code libsffile/sfile.c
+extern void SetSoundfontPresetCache (const gchar * filename);
 
 
 static gchar *GM_Instrument_Names[] = {
@@ -183,6 +184,22 @@ struct callbackdata
 };
 
 
+/* parse the presets of the soundfont preference, keeping them in a cache file in the user's data directory
+ * so that they are read from the soundfont itself only when it changes */
+static gint
+parse_soundfont_presets (void)
+{
+  static gboolean cache_set = FALSE;
+  if (!cache_set)
+    {
+      gchar *filename = g_build_filename (get_user_data_dir (TRUE), "soundfont-presets", NULL);
+      SetSoundfontPresetCache (filename);
+      g_free (filename);
+      cache_set = TRUE;
+    }
+  return ParseSoundfont (Denemo.prefs.fluidsynth_soundfont->str, 0, NULL, NULL, NULL);
+}
+
 /**
  * Set the staffs properties
  * @param cbdata pointer to the callback data structure containing the preference data to set.
@@ -261,7 +278,7 @@ set_properties (struct callbackdata *cbdata)
       gint i;
       gchar *name;
       gint preset, bank;
-      gint npresets = ParseSoundfont (Denemo.prefs.fluidsynth_soundfont->str, 0, NULL, NULL, NULL);
+      gint npresets = parse_soundfont_presets ();
       if (npresets)
         {
           for (i = 0; i < npresets - 1; i++)
@@ -364,7 +381,7 @@ staff_properties_change (void)
   gint i;
   gchar *name;
   gint preset = 0, bank = 0;
-  gint npresets = ParseSoundfont (Denemo.prefs.fluidsynth_soundfont->str, 0, NULL, NULL, NULL);
+  gint npresets = parse_soundfont_presets ();
   if (npresets)
     {
       gchar **array = g_malloc0 (128 * sizeof (gchar *));
@@ -0,0 +1,706 @@
+/*
+ * tuning-bench.c
+ *
+ * Standalone benchmark of the autocorrelation used by the tuning (pitch
+ * recognition) analysis in src/audio/audiocapture.c. The loop as it was,
+ * allocating its buffers and windowing and transforming the full window as
+ * complex data on every call, is compared with the current one, which keeps
+ * the transform and buffers for each window size and transforms the real
+ * input as a complex transform of half the size.
+ *
+ * Both are copied here from audiocapture.c so that they can be run on the
+ * same fixed buffers without audio hardware. If the current code there is
+ * changed, change the copy below to match.
+ *
+ * It is built by make check but not run as a test:
+ *   make -C tests check && tests/tuning-bench
+ *
+ * For each window size it prints the microseconds per frame of each and the
+ * largest difference between their results, relative to the largest value.
+ * The old loop computes its twiddle factors by a recurrence in single
+ * precision, which loses accuracy for the larger windows, so the difference
+ * grows with the window size; the current loop uses tabulated twiddles.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define SAMPLE_RATE (44100)
+#define FRAME_SAMPLES (SAMPLE_RATE / 4) /* a quarter second of audio, as determine_frequency () is given */
+#define REPEATS (200)
+
+static unsigned long WindowSize;
+
+#define	M_PI		3.14159265358979323846  /* pi */
+#define false 0
+#define true 1
+#define bool int
+
+/**********************************************************************
+  The autocorrelation before it was optimized
+**********************************************************************/
+
+static int **OldgFFTBitTable = NULL;
+static const int OldMaxFastBits = 16;
+
+static int
+OldIsPowerOfTwo (int x)
+{
+  if (x < 2)
+    return false;
+
+  if (x & (x - 1))              /* Thanks to 'byang' for this cute trick! */
+    return false;
+
+  return true;
+}
+
+static int
+OldNumberOfBitsNeeded (int PowerOfTwo)
+{
+  int i;
+
+  if (PowerOfTwo < 2)
+    {
+      fprintf (stderr, "Error: OldFFT called with size %d\n", PowerOfTwo);
+      exit (1);
+    }
+
+  for (i = 0;; i++)
+    if (PowerOfTwo & (1 << i))
+      return i;
+}
+
+static int
+OldReverseBits (int index, int NumBits)
+{
+  int i, rev;
+
+  for (i = rev = 0; i < NumBits; i++)
+    {
+      rev = (rev << 1) | (index & 1);
+      index >>= 1;
+    }
+
+  return rev;
+}
+
+static void
+OldInitFFT ()
+{
+  OldgFFTBitTable = malloc (sizeof (int *) * OldMaxFastBits);
+
+  int len = 2;
+  int b;
+  for (b = 1; b <= OldMaxFastBits; b++)
+    {
+
+      OldgFFTBitTable[b - 1] = malloc (sizeof (int) * len);
+      int i;
+      for (i = 0; i < len; i++)
+        OldgFFTBitTable[b - 1][i] = OldReverseBits (i, b);
+
+      len <<= 1;
+    }
+}
+
+static inline int
+OldFastReverseBits (int i, int NumBits)
+{
+  if (NumBits <= OldMaxFastBits)
+    return OldgFFTBitTable[NumBits - 1][i];
+  else
+    return OldReverseBits (i, NumBits);
+}
+
+/*
+ * Complex Fast Fourier Transform
+ */
+
+static void
+OldFFT (int NumSamples, bool InverseTransform, float *RealIn, float *ImagIn, float *RealOut, float *ImagOut)
+{
+  int NumBits;                  /* Number of bits needed to store indices */
+  int i, j, k, n;
+  int BlockSize, BlockEnd;
+
+  double angle_numerator = 2.0 * M_PI;
+  float tr, ti;                 /* temp real, temp imaginary */
+
+  if (!OldIsPowerOfTwo (NumSamples))
+    {
+      fprintf (stderr, "%d is not a power of two\n", NumSamples);
+      exit (1);
+    }
+
+  if (!OldgFFTBitTable)
+    OldInitFFT ();
+
+  if (InverseTransform)
+    angle_numerator = -angle_numerator;
+
+  NumBits = OldNumberOfBitsNeeded (NumSamples);
+
+  /*
+   **   Do simultaneous data copy and bit-reversal ordering into outputs...
+   */
+
+  for (i = 0; i < NumSamples; i++)
+    {
+      j = OldFastReverseBits (i, NumBits);
+      RealOut[j] = RealIn[i];
+      ImagOut[j] = (ImagIn == NULL) ? 0.0 : ImagIn[i];
+    }
+
+  /*
+   **   Do the OldFFT itself...
+   */
+
+  BlockEnd = 1;
+  for (BlockSize = 2; BlockSize <= NumSamples; BlockSize <<= 1)
+    {
+
+      double delta_angle = angle_numerator / (double) BlockSize;
+
+      float sm2 = sin (-2 * delta_angle);
+      float sm1 = sin (-delta_angle);
+      float cm2 = cos (-2 * delta_angle);
+      float cm1 = cos (-delta_angle);
+      float w = 2 * cm1;
+      float ar0, ar1, ar2, ai0, ai1, ai2;
+
+      for (i = 0; i < NumSamples; i += BlockSize)
+        {
+          ar2 = cm2;
+          ar1 = cm1;
+
+          ai2 = sm2;
+          ai1 = sm1;
+
+          for (j = i, n = 0; n < BlockEnd; j++, n++)
+            {
+              ar0 = w * ar1 - ar2;
+              ar2 = ar1;
+              ar1 = ar0;
+
+              ai0 = w * ai1 - ai2;
+              ai2 = ai1;
+              ai1 = ai0;
+
+              k = j + BlockEnd;
+              tr = ar0 * RealOut[k] - ai0 * ImagOut[k];
+              ti = ar0 * ImagOut[k] + ai0 * RealOut[k];
+
+              RealOut[k] = RealOut[j] - tr;
+              ImagOut[k] = ImagOut[j] - ti;
+
+              RealOut[j] += tr;
+              ImagOut[j] += ti;
+            }
+        }
+
+      BlockEnd = BlockSize;
+    }
+
+  /*
+   **   Need to normalize if inverse transform...
+   */
+
+  if (InverseTransform)
+    {
+      float denom = (float) NumSamples;
+
+      for (i = 0; i < NumSamples; i++)
+        {
+          RealOut[i] /= denom;
+          ImagOut[i] /= denom;
+        }
+    }
+}
+
+/*
+ * Windowing Functions
+ */
+
+static void
+OldWindowFunc (int whichFunction, int NumSamples, float *in)
+{
+  int i;
+
+  if (whichFunction == 1)
+    {
+      // Bartlett (triangular) window
+      for (i = 0; i < NumSamples / 2; i++)
+        {
+          in[i] *= (i / (float) (NumSamples / 2));
+          in[i + (NumSamples / 2)] *= (1.0 - (i / (float) (NumSamples / 2)));
+        }
+    }
+
+  if (whichFunction == 2)
+    {
+      // Hamming
+      for (i = 0; i < NumSamples; i++)
+        in[i] *= 0.54 - 0.46 * cos (2 * M_PI * i / (NumSamples - 1));
+    }
+
+  if (whichFunction == 3)
+    {
+      // Hanning
+      for (i = 0; i < NumSamples; i++)
+        in[i] *= 0.50 - 0.50 * cos (2 * M_PI * i / (NumSamples - 1));
+    }
+}
+
+
+// This is Audacity's FreqWindow::Recalc(), but shaved down to
+//   1) be enhanced auto-correlation only
+//   2) take parameters, and return values.
+static bool
+OldAutocorrelation (float mData[], // In
+                 int mDataLen,  // In
+                 float *processed[]     // Out
+  )
+{
+  if (mDataLen < WindowSize)
+    {
+      // Not enough data to get even one window
+      return false;
+    }
+
+//   float *mProcessed = NULL;
+  float *mProcessed = *processed;
+
+//   mProcessed = new float[WindowSize];
+
+  int i;
+  for (i = 0; i < WindowSize; i++)
+    mProcessed[i] = 0.0;
+  int half = WindowSize / 2;
+
+  float *in = malloc (sizeof (float) * WindowSize);
+  float *out = malloc (sizeof (float) * WindowSize);
+  float *out2 = malloc (sizeof (float) * WindowSize);
+
+  int start = 0;
+  int windows = 0;
+  while (start + WindowSize <= mDataLen)
+    {
+      // Copy stuff into in
+      for (i = 0; i < WindowSize; i++)
+        in[i] = mData[start + i];
+
+      // Window the data to lose crazy artifacts
+      // due to finite-length window
+      OldWindowFunc (2 /* Hamming */ , WindowSize, in);
+
+      // Enhanced AC
+
+      // Take OldFFT
+      OldFFT (WindowSize, false, in, NULL, out, out2);
+
+      // Compute power
+      for (i = 0; i < WindowSize; i++)
+        in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
+
+      // Tolonen and Karjalainen recommend taking the cube root
+      // of the power, instead of the square root
+
+      for (i = 0; i < WindowSize; i++)
+        in[i] = pow (in[i], 1.0 / 3.0);
+
+      // Take OldFFT
+      OldFFT (WindowSize, false, in, NULL, out, out2);
+
+      // Take real part of result
+      for (i = 0; i < half; i++)
+        mProcessed[i] += out[i];
+
+      start += half;
+      windows++;
+    }
+
+  // Enhanced OldAutocorrelation
+  for (i = 0; i < half; i++)
+    mProcessed[i] = mProcessed[i] / windows;
+
+  // Peak Pruning as described by Tolonen and Karjalainen, 2000
+
+  // Clip at zero, copy to temp array
+  for (i = 0; i < half; i++)
+    {
+      if (mProcessed[i] < 0.0)
+        mProcessed[i] = 0.0;
+      out[i] = mProcessed[i];
+    }
+
+  // Subtract a time-doubled signal (linearly interp.) from the original
+  // (clipped) signal
+  for (i = 0; i < half; i++)
+    if ((i % 2) == 0)
+      mProcessed[i] -= out[i / 2];
+    else
+      mProcessed[i] -= ((out[i / 2] + out[i / 2 + 1]) / 2);
+
+  // Clip at zero again
+  for (i = 0; i < half; i++)
+    if (mProcessed[i] < 0.0)
+      mProcessed[i] = 0.0;
+
+  /*  *mProcessedSize = half; */
+
+  free (in);
+  free (out);
+  free (out2);
+
+//   *processed = mProcessed;
+
+  return true;
+}
+
+/**********************************************************************
+  The autocorrelation as it is now in audiocapture.c
+**********************************************************************/
+
+
+typedef struct NewRealFFT
+{
+  int size;                     /* number of real samples transformed */
+  int *bitrev;                  /* bit reversed indexes for the complex transform of size/2 */
+  float *cosine;                /* cos(2 pi k/size), k < size/2 */
+  float *sine;                  /* sin(2 pi k/size), k < size/2 */
+  float *window;                /* Hamming window of size samples */
+  float *in;                    /* work buffers */
+  float *re;
+  float *im;
+} NewRealFFT;
+
+static NewRealFFT *NewgFFT = NULL;
+
+static int
+NewIsPowerOfTwo (int x)
+{
+  if (x < 2)
+    return false;
+
+  if (x & (x - 1))              /* Thanks to 'byang' for this cute trick! */
+    return false;
+
+  return true;
+}
+
+static int
+NewReverseBits (int index, int NumBits)
+{
+  int i, rev;
+
+  for (i = rev = 0; i < NumBits; i++)
+    {
+      rev = (rev << 1) | (index & 1);
+      index >>= 1;
+    }
+
+  return rev;
+}
+
+static void
+NewFreeFFT (NewRealFFT * f)
+{
+  free (f->bitrev);
+  free (f->cosine);
+  free (f->sine);
+  free (f->window);
+  free (f->in);
+  free (f->re);
+  free (f->im);
+  free (f);
+}
+
+/* the transform for windows of size samples, made if the size has changed */
+static NewRealFFT *
+NewGetFFT (int size)
+{
+  int half = size / 2;
+  int bits, i;
+  if (NewgFFT && (NewgFFT->size == size))
+    return NewgFFT;
+  if (NewgFFT)
+    NewFreeFFT (NewgFFT);
+  NewgFFT = malloc (sizeof (NewRealFFT));
+  NewgFFT->size = size;
+  NewgFFT->bitrev = malloc (sizeof (int) * half);
+  NewgFFT->cosine = malloc (sizeof (float) * half);
+  NewgFFT->sine = malloc (sizeof (float) * half);
+  NewgFFT->window = malloc (sizeof (float) * size);
+  NewgFFT->in = malloc (sizeof (float) * size);
+  NewgFFT->re = malloc (sizeof (float) * (half + 1));
+  NewgFFT->im = malloc (sizeof (float) * (half + 1));
+  for (bits = 0; (1 << bits) < half; bits++)
+    ;
+  for (i = 0; i < half; i++)
+    {
+      NewgFFT->bitrev[i] = NewReverseBits (i, bits);
+      NewgFFT->cosine[i] = cos (2 * M_PI * i / size);
+      NewgFFT->sine[i] = sin (2 * M_PI * i / size);
+    }
+  for (i = 0; i < size; i++)
+    NewgFFT->window[i] = 0.54 - 0.46 * cos (2 * M_PI * i / (size - 1));
+  return NewgFFT;
+}
+
+/*
+ * Complex Fast Fourier Transform of f->size/2 points, in place
+ */
+
+static void
+NewComplexFFT (NewRealFFT * f, float *re, float *im)
+{
+  int n = f->size / 2;
+  int i, j, k, half, step;
+
+  for (i = 0; i < n; i++)
+    {
+      j = f->bitrev[i];
+      if (j > i)
+        {
+          float t = re[i];
+          re[i] = re[j];
+          re[j] = t;
+          t = im[i];
+          im[i] = im[j];
+          im[j] = t;
+        }
+    }
+
+  /* blocks of 2*half points, using every step'th twiddle */
+  for (half = 1, step = n; half < n; half <<= 1, step >>= 1)
+    for (i = 0; i < n; i += 2 * half)
+      for (j = i, k = 0; j < i + half; j++, k += step)
+        {
+          float wr = f->cosine[k], wi = -f->sine[k];
+          float tr = wr * re[j + half] - wi * im[j + half];
+          float ti = wr * im[j + half] + wi * re[j + half];
+          re[j + half] = re[j] - tr;
+          im[j + half] = im[j] - ti;
+          re[j] += tr;
+          im[j] += ti;
+        }
+}
+
+/*
+ * Fast Fourier Transform of the f->size real samples x,
+ * giving bins 0 to size/2 in re and im (the rest are their complex conjugates)
+ */
+
+static void
+NewRealFFTransform (NewRealFFT * f, const float *x, float *re, float *im)
+{
+  int n = f->size / 2;
+  int k;
+
+  /* the even samples as real part and the odd as imaginary */
+  for (k = 0; k < n; k++)
+    {
+      re[k] = x[2 * k];
+      im[k] = x[2 * k + 1];
+    }
+
+  NewComplexFFT (f, re, im);
+
+  /* separate the transforms of the even and odd samples E, O and combine them as E + W^k O,
+   * using X[n-k] = conj(E[k] - W^k O[k]) to do bins k and n-k together */
+  re[n] = re[0] - im[0];
+  im[n] = 0.0;
+  re[0] = re[0] + im[0];
+  im[0] = 0.0;
+  for (k = 1; k <= n / 2; k++)
+    {
+      int j = n - k;
+      float er = (re[k] + re[j]) / 2, ei = (im[k] - im[j]) / 2;
+      float odr = (im[k] + im[j]) / 2, odi = (re[j] - re[k]) / 2;
+      float wr = f->cosine[k], wi = -f->sine[k];
+      float tr = wr * odr - wi * odi, ti = wr * odi + wi * odr;
+      re[k] = er + tr;
+      im[k] = ei + ti;
+      re[j] = er - tr;
+      im[j] = ti - ei;
+    }
+}
+
+
+// This is Audacity's FreqWindow::Recalc(), but shaved down to
+//   1) be enhanced auto-correlation only
+//   2) take parameters, and return values.
+static bool
+NewAutocorrelation (float mData[], // In
+                 int mDataLen,  // In
+                 float *processed[]     // Out
+  )
+{
+  if (mDataLen < WindowSize)
+    {
+      // Not enough data to get even one window
+      return false;
+    }
+  if (!NewIsPowerOfTwo (WindowSize))
+    {
+      fprintf (stderr, "%lu is not a power of two\n", WindowSize);
+      return false;
+    }
+
+  float *mProcessed = *processed;
+  NewRealFFT *f = NewGetFFT (WindowSize);
+  float *in = f->in;
+  float *re = f->re;
+  float *im = f->im;
+  const float *window = f->window;
+
+  int i;
+  for (i = 0; i < WindowSize; i++)
+    mProcessed[i] = 0.0;
+  int half = WindowSize / 2;
+
+  int start = 0;
+  int windows = 0;
+  while (start + WindowSize <= mDataLen)
+    {
+      const float *x = mData + start;
+
+      // Window the data to lose crazy artifacts
+      // due to finite-length window
+      for (i = 0; i < WindowSize; i++)
+        in[i] = x[i] * window[i];
+
+      // Enhanced AC
+
+      // Take FFT
+      NewRealFFTransform (f, in, re, im);
+
+      // Compute power
+      for (i = 0; i <= half; i++)
+        in[i] = (re[i] * re[i]) + (im[i] * im[i]);
+
+      // Tolonen and Karjalainen recommend taking the cube root
+      // of the power, instead of the square root
+
+      for (i = 0; i <= half; i++)
+        in[i] = cbrtf (in[i]);
+
+      // The power is symmetric about half
+      for (i = 1; i < half; i++)
+        in[WindowSize - i] = in[i];
+
+      // Take FFT
+      NewRealFFTransform (f, in, re, im);
+
+      // Take real part of result
+      for (i = 0; i < half; i++)
+        mProcessed[i] += re[i];
+
+      start += half;
+      windows++;
+    }
+
+  // Enhanced NewAutocorrelation
+  for (i = 0; i < half; i++)
+    mProcessed[i] = mProcessed[i] / windows;
+
+  // Peak Pruning as described by Tolonen and Karjalainen, 2000
+
+  // Clip at zero, copy to temp array
+  for (i = 0; i < half; i++)
+    {
+      if (mProcessed[i] < 0.0)
+        mProcessed[i] = 0.0;
+      in[i] = mProcessed[i];
+    }
+
+  // Subtract a time-doubled signal (linearly interp.) from the original
+  // (clipped) signal
+  for (i = 0; i < half; i++)
+    if ((i % 2) == 0)
+      mProcessed[i] -= in[i / 2];
+    else
+      mProcessed[i] -= ((in[i / 2] + in[i / 2 + 1]) / 2);
+
+  // Clip at zero again
+  for (i = 0; i < half; i++)
+    if (mProcessed[i] < 0.0)
+      mProcessed[i] = 0.0;
+
+  /*  *mProcessedSize = half; */
+
+  return true;
+}
+
+/**********************************************************************
+  The benchmark
+**********************************************************************/
+
+static double
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e6 + t.tv_nsec / 1e3;
+}
+
+/* a fixed test signal: a 220Hz tone with its harmonics and some noise from a fixed seed */
+static void
+make_signal (float *data, int n)
+{
+  unsigned int seed = 12345;
+  int i;
+  for (i = 0; i < n; i++)
+    {
+      double t = (double) i / SAMPLE_RATE;
+      seed = seed * 1103515245 + 12345;
+      data[i] = 0.5 * sin (2 * M_PI * 220 * t) + 0.25 * sin (2 * M_PI * 440 * t) + 0.125 * sin (2 * M_PI * 660 * t) + 0.05 * (((seed >> 16) & 0x7fff) / 16384.0 - 1.0);
+    }
+}
+
+static double
+time_per_frame (bool (*autocorrelation) (float *, int, float **), float *data, float **result)
+{
+  double start;
+  int i;
+  autocorrelation (data, FRAME_SAMPLES, result);        /* once first, so that any setup is not timed */
+  start = now ();
+  for (i = 0; i < REPEATS; i++)
+    autocorrelation (data, FRAME_SAMPLES, result);
+  return (now () - start) / REPEATS;
+}
+
+int
+main (void)
+{
+  static const unsigned long sizes[] = { 1024, 2048, 4096, 8192 };
+  float *data = malloc (sizeof (float) * FRAME_SAMPLES);
+  float *old_result = malloc (sizeof (float) * 16384);
+  float *new_result = malloc (sizeof (float) * 16384);
+  unsigned int s;
+  make_signal (data, FRAME_SAMPLES);
+  printf ("window  old us/frame  new us/frame  speedup  max relative difference\n");
+  for (s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++)
+    {
+      double old_time, new_time, largest = 0.0, difference = 0.0;
+      unsigned long i;
+      WindowSize = sizes[s];
+      old_time = time_per_frame (OldAutocorrelation, data, &old_result);
+      new_time = time_per_frame (NewAutocorrelation, data, &new_result);
+      for (i = 0; i < WindowSize / 2; i++)
+        {
+          largest = fmax (largest, fabs (old_result[i]));
+          difference = fmax (difference, fabs (old_result[i] - new_result[i]));
+        }
+      difference /= (largest > 0.0) ? largest : 1.0;
+      printf ("%6lu  %12.1f  %12.1f  %7.2f  %g\n", WindowSize, old_time, new_time, old_time / new_time, difference);
+    }
+  free (data);
+  free (old_result);
+  free (new_result);
+  return 0;
+}
@@ -1,6 +1,7 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <unistd.h>
+#include <string.h>
 #include <config.h>
 #include "common.h"
 
@@ -105,6 +106,84 @@ test_scheme_log_error(gpointer fixture, gconstpointer data)
   g_test_trap_assert_failed ();
 }
 
+/** test_scheme_batch
+ * Tests that edits made inside (d-Batch) are applied and that nested
+ * batches are balanced on exit.
+ */
+static void
+test_scheme_batch(gpointer fixture, gconstpointer data)
+{
+  if (g_test_subprocess ())
+    {
+      execl(DENEMO, DENEMO, "-n", "--fatal-scheme-errors", "-a",
+            "(d-Batch (lambda () (d-Insert0) (d-Batch (lambda () (d-Insert1)))))"
+            "(d-MoveToBeginning)"
+            "(if (not (d-NextObject)) (d-Error \"Batched edits missing\"))"
+            "(if (d-EndBatch) (d-Error \"Batch left open\"))"
+            "(d-Quit)",
+            NULL);
+      g_warn_if_reached ();
+    }
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_test_trap_assert_passed ();
+}
+
+/** test_scheme_undo_telescoped
+ * Tests that repeated changes to one note inside a batch are undone
+ * together, back to the note as it was before the batch.
+ */
+static void
+test_scheme_undo_telescoped(gpointer fixture, gconstpointer data)
+{
+  if (g_test_subprocess ())
+    {
+      execl(DENEMO, DENEMO, "-n", "--fatal-scheme-errors", "-a",
+            "(d-Insert0)(d-MoveToBeginning)"
+            "(define before (d-GetNote))"
+            "(d-Batch (lambda () (d-OctaveUp) (d-OctaveUp) (d-OctaveUp)))"
+            "(if (equal? before (d-GetNote)) (d-Error \"Batched changes missing\"))"
+            "(d-Undo)"
+            "(if (not (equal? before (d-GetNote))) (d-Error \"Batched changes not undone\"))"
+            "(d-Quit)",
+            NULL);
+      g_warn_if_reached ();
+    }
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_test_trap_assert_passed ();
+}
+
+/** test_scheme_object_records
+ * Tests that writing back unchanged object records changes nothing, that
+ * a malformed note record is refused without touching the chord and
+ * that a changed note record is written to the score.
+ */
+static void
+test_scheme_object_records(gpointer fixture, gconstpointer data)
+{
+  if (g_test_subprocess ())
+    {
+      execl(DENEMO, DENEMO, "-n", "--fatal-scheme-errors", "-a",
+            "(d-Insert0)(d-SetSaved)"
+            "(define records (d-GetMeasureObjects))"
+            "(if (not (eqv? 0 (d-SetMeasureObjects records))) (d-Error \"Unchanged records written\"))"
+            "(if (not (d-GetSaved)) (d-Error \"Unchanged records marked the score changed\"))"
+            "(define bad (vector (vector-copy (vector-ref records 0))))"
+            "(vector-set! (vector-ref bad 0) 5 (list (vector 1 0) (vector \"e\" 0)))"
+            "(if (d-SetMeasureObjects bad) (d-Error \"Malformed record written\"))"
+            "(d-MoveToBeginning)"
+            "(if (not (equal? \"c'\" (d-GetNote))) (d-Error \"Malformed record changed the chord\"))"
+            "(vector-set! (car (vector-ref (vector-ref records 0) 5)) 0 1)"
+            "(if (not (eqv? 1 (d-SetMeasureObjects records))) (d-Error \"Changed record not written\"))"
+            "(d-MoveToBeginning)"
+            "(if (not (equal? \"d'\" (d-GetNote))) (d-Error \"Written note is wrong\"))"
+            "(d-Quit)",
+            NULL);
+      g_warn_if_reached ();
+    }
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_test_trap_assert_passed ();
+}
+
 /** test_thumbnailer
  * Tries to create a thumbnail from a file and check that its exists
  */
@@ -128,6 +207,62 @@ test_thumbnailer(gpointer fixture, gconstpointer data)
   g_assert(g_remove(thumbnail) >= 0);
 }
 
+/** test_batch_conversion
+ * Converts a file with --batch and checks the output and the JSON report
+ */
+static void
+test_batch_conversion(gpointer fixture, gconstpointer data)
+{
+  gchar* input = g_build_filename(data_dir, "denemo", "blank.denemo", NULL);
+  gchar* output = g_build_filename(temp_dir, "blank.ly", NULL);
+  gchar* manifest = g_build_filename(temp_dir, "manifest.txt", NULL);
+  gchar* report = g_build_filename(temp_dir, "report.json", NULL);
+  gchar* lines = g_strdup_printf("# test manifest\n%s\t%s\n", input, output);
+  gchar* contents = NULL;
+  g_assert(g_file_set_contents(manifest, lines, -1, NULL));
+
+  if (g_test_subprocess ())
+    {
+      execl(DENEMO, DENEMO, "--batch", manifest, "--batch-report", report, "--jobs", "1", NULL);
+      g_warn_if_reached ();
+    }
+
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_test_trap_assert_passed ();
+  g_assert(g_file_test(output, G_FILE_TEST_EXISTS));
+  g_assert(g_file_get_contents(report, &contents, NULL, NULL));
+  g_assert(strstr(contents, "\"failed\": 0") != NULL);
+  g_free(contents);
+}
+
+/** test_mxl_export
+ * Exports a file as compressed MusicXML and checks it is a zip archive with the MusicXML mimetype first
+ */
+static void
+test_mxl_export(gpointer fixture, gconstpointer data)
+{
+  gchar* input = g_build_filename(data_dir, "denemo", "blank.denemo", NULL);
+  gchar* output = g_build_filename(temp_dir, "blank.mxl", NULL);
+  gchar* manifest = g_build_filename(temp_dir, "manifest.txt", NULL);
+  gchar* lines = g_strdup_printf("%s\t%s\n", input, output);
+  gchar* contents = NULL;
+  gsize length = 0;
+  g_assert(g_file_set_contents(manifest, lines, -1, NULL));
+
+  if (g_test_subprocess ())
+    {
+      execl(DENEMO, DENEMO, "--batch", manifest, "--jobs", "1", NULL);
+      g_warn_if_reached ();
+    }
+
+  g_test_trap_subprocess (NULL, 0, 0);
+  g_test_trap_assert_passed ();
+  g_assert(g_file_get_contents(output, &contents, &length, NULL));
+  g_assert(length > 30 && !memcmp(contents, "PK\003\004", 4));
+  g_assert(!memcmp(contents + 30, "mimetype", 8));
+  g_free(contents);
+}
+
 /*******************************************************************************
  * MAIN
  ******************************************************************************/
@@ -154,7 +289,12 @@ main (int argc, char *argv[])
   //g_test_add ("/unit/invalid-scheme", void, NULL, setup, test_invalid_scheme, teardown);
   g_test_add ("/unit/scheme-log", void, NULL, setup, test_scheme_log, teardown);
   g_test_add ("/unit/scheme-log-error", void, NULL, setup, test_scheme_log_error, teardown);
+  g_test_add ("/unit/scheme-batch", void, NULL, setup, test_scheme_batch, teardown);
+  g_test_add ("/unit/scheme-undo-telescoped", void, NULL, setup, test_scheme_undo_telescoped, teardown);
+  g_test_add ("/unit/scheme-object-records", void, NULL, setup, test_scheme_object_records, teardown);
   g_test_add ("/unit/thumbnailer", void, NULL, setup, test_thumbnailer, teardown);
+  g_test_add ("/unit/batch-conversion", void, NULL, setup, test_batch_conversion, teardown);
+  g_test_add ("/unit/mxl-export", void, NULL, setup, test_mxl_export, teardown);
 
   return g_test_run ();
 }